@@ -0,0 +1,874 @@
+#include "audio_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <array>
+
+#include "logging.h"
+#include "pico/stdlib.h"
+
+#if DEBUG_CUE
+#define DEBUG_PRINT(...) printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINT(...) while (0)
+#endif
+
+namespace AudioFormat {
+enum : uint8_t {
+    WAVE,
+    FLAC,
+};
+}
+
+// FLAC channel assignments for stereo, see the FLAC format specification
+namespace ChannelAssignment {
+enum : uint8_t {
+    INDEPENDENT = 1,
+    LEFT_SIDE = 8,
+    SIDE_RIGHT = 9,
+    MID_SIDE = 10,
+};
+}
+
+static constexpr uint32_t c_maxBlockSize = 4608;  // Largest block size of the FLAC subset at 44.1 kHz
+static constexpr uint c_slotShift = 16;            // One seek slot per 65536 samples, about 1.5 s
+static constexpr uint c_minProbes = 32;            // Slots found at load in files without a SEEKTABLE
+static constexpr uint32_t c_anySample = 0xFFFFFFFF;
+
+// One per attached file, allocated at attach and freed by reset()
+struct AudioFile {
+    AudioFile *next;
+    const CueFile *file;
+    FIL *fil;
+    uint8_t format;
+    uint32_t dataOffset;  // WAVE: start of the data chunk, FLAC: first frame
+    uint32_t decodedSize;
+    // FLAC only
+    bool variableBlockSize;
+    uint32_t blockSize;      // Nominal, frame numbers of fixed block size streams count these
+    uint32_t maxFrameBytes;  // How far a header scan looks for the next frame
+    uint32_t totalSamples;
+    // Slot n holds the offset of a frame starting at or before sample n << c_slotShift, 0 while unknown. Slot 0
+    // is the first frame; the rest come from the SEEKTABLE or load time probes and are refined during play.
+    uint32_t slotCount;
+    uint32_t *slots;
+};
+
+struct FrameHeader {
+    uint32_t sample;
+    uint32_t blockSize;
+    uint8_t channelAssignment;
+};
+
+// FLAC's frame CRC-16: polynomial 0x8005, MSB first, zero initial value
+static constexpr std::array<uint16_t, 256> c_crc16Lut = [] {
+    std::array<uint16_t, 256> lut{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint16_t crc = i << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc << 1) ^ ((crc & 0x8000) ? 0x8005 : 0);
+        }
+        lut[i] = crc;
+    }
+    return lut;
+}();
+
+// MSB first bit reader over a FatFs file, refilled a byte at a time from a 512 byte buffer. Keeps the CRC-16 of
+// the bytes read since the last start or seek, which is 0 at the end of a frame whose CRC matches.
+class BitReader {
+  public:
+    void start(FIL *fil, uint32_t offset) {
+        m_fil = fil;
+        m_offset = offset;
+        m_position = 0;
+        m_length = 0;
+        m_cache = 0;
+        m_count = 0;
+        m_eof = false;
+        m_crc = 0;
+        f_lseek(fil, offset);
+    }
+
+    // Like start, but without touching the card when offset is still in the buffer
+    void seek(FIL *fil, uint32_t offset) {
+        const uint32_t base = m_offset - m_position;  // Of m_buffer[0]
+        if (fil != m_fil || offset < base || offset > base + m_length) {
+            start(fil, offset);
+            return;
+        }
+        m_offset = offset;
+        m_position = offset - base;
+        m_cache = 0;
+        m_count = 0;
+        m_eof = false;
+        m_crc = 0;
+    }
+
+    uint32_t bits(uint n) {
+        if (n > 24) {
+            const uint32_t high = bits(n - 16);
+            return (high << 16) | bits(16);
+        }
+        if (n == 0) {
+            return 0;
+        }
+        while (m_count < n) {
+            m_cache |= uint32_t(nextByte()) << (24 - m_count);
+            m_count += 8;
+        }
+        const uint32_t value = m_cache >> (32 - n);
+        m_cache <<= n;
+        m_count -= n;
+        return value;
+    }
+
+    int32_t signedBits(uint n) {
+        if (n == 0) {
+            return 0;
+        }
+        return int32_t(bits(n) << (32 - n)) >> (32 - n);
+    }
+
+    // Number of 0 bits before the next 1 bit, which is consumed
+    uint32_t unary() {
+        uint32_t zeros = 0;
+        while (!m_cache) {
+            zeros += m_count;
+            m_cache = uint32_t(nextByte()) << 24;
+            m_count = 8;
+            if (m_eof) {
+                return zeros;
+            }
+        }
+        const uint leading = __builtin_clz(m_cache);
+        zeros += leading;
+        m_cache = (leading == 31) ? 0 : m_cache << (leading + 1);
+        m_count -= leading + 1;
+        return zeros;
+    }
+
+    void align() {
+        const uint remainder = m_count & 7;
+        m_cache <<= remainder;
+        m_count -= remainder;
+    }
+
+    uint32_t tell() const { return m_offset - m_count / 8; }  // Only valid when byte aligned
+    bool eof() const { return m_eof && m_count == 0; }
+    uint16_t crc() const { return m_crc; }  // Only valid when byte aligned, bytes are fetched as they are needed
+
+  private:
+    uint8_t nextByte() {
+        if (m_position == m_length) {
+            UINT br = 0;
+            f_read(m_fil, m_buffer, sizeof(m_buffer), &br);
+            m_position = 0;
+            m_length = br;
+            m_eof = (br == 0);
+            if (m_eof) {
+                return 0;
+            }
+        }
+        m_offset++;
+        const uint8_t value = m_buffer[m_position++];
+        m_crc = (m_crc << 8) ^ c_crc16Lut[(m_crc >> 8) ^ value];
+        return value;
+    }
+
+    FIL *m_fil = nullptr;
+    uint32_t m_offset = 0;  // Of the next byte to come out of m_buffer
+    uint m_position = 0;
+    uint m_length = 0;
+    uint32_t m_cache = 0;  // Left aligned, m_count valid bits
+    uint m_count = 0;
+    bool m_eof = false;
+    uint16_t m_crc = 0;
+    uint8_t m_buffer[512];
+};
+
+static AudioFile *s_files = nullptr;
+
+// One decoded FLAC frame, shared by all files. Two channels of s_blockCapacity samples, allocated with the first
+// FLAC file and sized by the largest STREAMINFO block size. After decoding, the first channel holds the frame as
+// packed 16-bit stereo samples, the layout of a raw CD audio track.
+static BitReader s_reader;
+static int32_t *s_channels = nullptr;
+static uint32_t s_blockCapacity = 0;
+static const AudioFile *s_frameOwner = nullptr;
+static uint32_t s_frameSample = 0;
+static uint32_t s_frameSamples = 0;
+
+// Where the last walk stopped: the header of the next frame in the file and its first sample
+static const AudioFile *s_walkOwner = nullptr;
+static uint32_t s_walkOffset = 0;
+static uint32_t s_walkSample = 0;
+
+static uint32_t readLE32(const uint8_t *data) { return data[0] | data[1] << 8 | data[2] << 16 | data[3] << 24; }
+static uint16_t readLE16(const uint8_t *data) { return data[0] | data[1] << 8; }
+
+static uint8_t crc8(const uint8_t *data, uint length) {
+    uint8_t crc = 0;
+    for (uint i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static bool readAt(FIL *fil, uint32_t offset, void *buffer, UINT length) {
+    UINT br;
+    return f_lseek(fil, offset) == FR_OK && f_read(fil, buffer, length, &br) == FR_OK && br == length;
+}
+
+// Only frames a CD could hold are accepted: stereo, 44.1 kHz, 16 bits
+template <typename NextByte>
+static bool parseFrameHeader(NextByte &&next, const AudioFile *audio, FrameHeader *header) {
+    uint8_t bytes[16];
+    uint count = 0;
+    auto get = [&]() {
+        const uint8_t value = next();
+        bytes[count++] = value;
+        return value;
+    };
+
+    if (get() != 0xFF) {
+        return false;
+    }
+    const uint8_t sync = get();
+    if ((sync & 0xFE) != 0xF8 || bool(sync & 1) != audio->variableBlockSize) {
+        return false;
+    }
+    const uint8_t sizeRate = get();
+    const uint8_t blockSizeCode = sizeRate >> 4;
+    const uint8_t sampleRateCode = sizeRate & 0x0F;
+    const uint8_t channelBits = get();
+    const uint8_t channelAssignment = channelBits >> 4;
+    const uint8_t sampleSizeCode = (channelBits >> 1) & 7;
+    if (blockSizeCode == 0 || (sampleRateCode != 0 && sampleRateCode != 9) ||
+        (sampleSizeCode != 0 && sampleSizeCode != 4) || (channelBits & 1) ||
+        (channelAssignment != ChannelAssignment::INDEPENDENT && channelAssignment < ChannelAssignment::LEFT_SIDE) ||
+        channelAssignment > ChannelAssignment::MID_SIDE) {
+        return false;
+    }
+
+    // Frame or sample number, UTF-8 style
+    const uint8_t first = get();
+    uint64_t number;
+    uint extra;
+    if (!(first & 0x80)) {
+        number = first;
+        extra = 0;
+    } else if ((first & 0xE0) == 0xC0) {
+        number = first & 0x1F;
+        extra = 1;
+    } else if ((first & 0xF0) == 0xE0) {
+        number = first & 0x0F;
+        extra = 2;
+    } else if ((first & 0xF8) == 0xF0) {
+        number = first & 0x07;
+        extra = 3;
+    } else if ((first & 0xFC) == 0xF8) {
+        number = first & 0x03;
+        extra = 4;
+    } else if ((first & 0xFE) == 0xFC) {
+        number = first & 0x01;
+        extra = 5;
+    } else if (first == 0xFE) {
+        number = 0;
+        extra = 6;
+    } else {
+        return false;
+    }
+    for (uint i = 0; i < extra; i++) {
+        const uint8_t value = get();
+        if ((value & 0xC0) != 0x80) {
+            return false;
+        }
+        number = (number << 6) | (value & 0x3F);
+    }
+
+    uint32_t blockSize;
+    if (blockSizeCode == 1) {
+        blockSize = 192;
+    } else if (blockSizeCode <= 5) {
+        blockSize = 576 << (blockSizeCode - 2);
+    } else if (blockSizeCode == 6) {
+        blockSize = get() + 1;
+    } else if (blockSizeCode == 7) {
+        const uint32_t high = get();
+        blockSize = ((high << 8) | get()) + 1;
+    } else {
+        blockSize = 256 << (blockSizeCode - 8);
+    }
+
+    const uint8_t crc = crc8(bytes, count);
+    if (get() != crc || blockSize > c_maxBlockSize) {
+        return false;
+    }
+
+    const uint64_t sample = audio->variableBlockSize ? number : number * audio->blockSize;
+    if (sample >= audio->totalSamples) {
+        return false;
+    }
+    header->sample = sample;
+    header->blockSize = blockSize;
+    header->channelAssignment = channelAssignment;
+    return true;
+}
+
+static bool __time_critical_func(decodeResidual)(uint32_t blockSize, uint order, int32_t *out) {
+    BitReader &reader = s_reader;
+    const uint32_t method = reader.bits(2);
+    if (method > 1) {
+        return false;
+    }
+    const uint parameterBits = method ? 5 : 4;
+    const uint32_t escape = method ? 31 : 15;
+    const uint partitionOrder = reader.bits(4);
+    const uint32_t partitionSamples = blockSize >> partitionOrder;
+    if ((partitionSamples << partitionOrder) != blockSize || partitionSamples < order) {
+        return false;
+    }
+
+    uint32_t i = order;
+    for (uint32_t partition = 0; partition < (1u << partitionOrder); partition++) {
+        const uint32_t parameter = reader.bits(parameterBits);
+        const uint32_t end = i + (partition == 0 ? partitionSamples - order : partitionSamples);
+        if (parameter == escape) {
+            const uint bits = reader.bits(5);
+            for (; i < end; i++) {
+                out[i] = reader.signedBits(bits);
+            }
+        } else {
+            for (; i < end; i++) {
+                const uint32_t value = (reader.unary() << parameter) | reader.bits(parameter);
+                out[i] = int32_t(value >> 1) ^ -int32_t(value & 1);
+            }
+        }
+    }
+    return !reader.eof();
+}
+
+static bool __time_critical_func(decodeSubframe)(uint32_t blockSize, uint bps, int32_t *out) {
+    BitReader &reader = s_reader;
+    if (reader.bits(1)) {
+        return false;
+    }
+    const uint type = reader.bits(6);
+    uint wasted = 0;
+    if (reader.bits(1)) {
+        wasted = reader.unary() + 1;
+        if (wasted >= bps) {
+            return false;
+        }
+        bps -= wasted;
+    }
+
+    if (type == 0) {  // Constant
+        const int32_t value = reader.signedBits(bps);
+        for (uint32_t i = 0; i < blockSize; i++) {
+            out[i] = value;
+        }
+    } else if (type == 1) {  // Verbatim
+        for (uint32_t i = 0; i < blockSize; i++) {
+            out[i] = reader.signedBits(bps);
+        }
+    } else if (type >= 8 && type <= 12) {  // Fixed predictor
+        const uint order = type - 8;
+        if (order > blockSize) {
+            return false;
+        }
+        for (uint i = 0; i < order; i++) {
+            out[i] = reader.signedBits(bps);
+        }
+        if (!decodeResidual(blockSize, order, out)) {
+            return false;
+        }
+        switch (order) {
+            case 1:
+                for (uint32_t i = 1; i < blockSize; i++) {
+                    out[i] += out[i - 1];
+                }
+                break;
+            case 2:
+                for (uint32_t i = 2; i < blockSize; i++) {
+                    out[i] += 2 * out[i - 1] - out[i - 2];
+                }
+                break;
+            case 3:
+                for (uint32_t i = 3; i < blockSize; i++) {
+                    out[i] += 3 * out[i - 1] - 3 * out[i - 2] + out[i - 3];
+                }
+                break;
+            case 4:
+                for (uint32_t i = 4; i < blockSize; i++) {
+                    out[i] += 4 * out[i - 1] - 6 * out[i - 2] + 4 * out[i - 3] - out[i - 4];
+                }
+                break;
+        }
+    } else if (type >= 32) {  // LPC
+        const uint order = type - 31;
+        if (order > blockSize) {
+            return false;
+        }
+        for (uint i = 0; i < order; i++) {
+            out[i] = reader.signedBits(bps);
+        }
+        const uint precision = reader.bits(4) + 1;
+        const int shift = reader.signedBits(5);
+        if (precision == 16 || shift < 0) {
+            return false;
+        }
+        int32_t coefficients[32];
+        for (uint i = 0; i < order; i++) {
+            coefficients[i] = reader.signedBits(precision);
+        }
+        if (!decodeResidual(blockSize, order, out)) {
+            return false;
+        }
+
+        // 32-bit sums are exact while bps + precision + log2(order) fits, as in the reference decoder
+        const uint orderBits = 32 - __builtin_clz(order);
+        if (bps + precision + orderBits <= 32) {
+            for (uint32_t i = order; i < blockSize; i++) {
+                int32_t sum = 0;
+                for (uint j = 0; j < order; j++) {
+                    sum += coefficients[j] * out[i - 1 - j];
+                }
+                out[i] += sum >> shift;
+            }
+        } else {
+            for (uint32_t i = order; i < blockSize; i++) {
+                int64_t sum = 0;
+                for (uint j = 0; j < order; j++) {
+                    sum += int64_t(coefficients[j]) * out[i - 1 - j];
+                }
+                out[i] += int32_t(sum >> shift);
+            }
+        }
+    } else {
+        return false;
+    }
+
+    if (wasted) {
+        for (uint32_t i = 0; i < blockSize; i++) {
+            out[i] <<= wasted;
+        }
+    }
+    return true;
+}
+
+static bool readHeader(const AudioFile *audio, FrameHeader *header) {
+    return parseFrameHeader([] { return uint8_t(s_reader.bits(8)); }, audio, header);
+}
+
+// Decodes the rest of the frame whose header was just read into s_channels
+static bool decodeFrame(const AudioFile *audio, const FrameHeader &header) {
+    const uint8_t assignment = header.channelAssignment;
+    const uint32_t blockSize = header.blockSize;
+    if (blockSize > s_blockCapacity) {
+        return false;
+    }
+    for (uint channel = 0; channel < 2; channel++) {
+        const bool side = (assignment == ChannelAssignment::LEFT_SIDE && channel == 1) ||
+                          (assignment == ChannelAssignment::SIDE_RIGHT && channel == 0) ||
+                          (assignment == ChannelAssignment::MID_SIDE && channel == 1);
+        if (!decodeSubframe(blockSize, side ? 17 : 16, s_channels + channel * s_blockCapacity)) {
+            return false;
+        }
+    }
+    s_reader.align();
+    s_reader.bits(16);  // The frame's CRC-16, which brings the running CRC from the header on to 0
+    if (s_reader.crc() != 0) {
+        DEBUG_PRINT("FLAC: frame CRC error, sample %lu\n", header.sample);
+        return false;
+    }
+
+    int32_t *a = s_channels;
+    const int32_t *b = s_channels + s_blockCapacity;
+    uint32_t *packed = reinterpret_cast<uint32_t *>(s_channels);
+    for (uint32_t i = 0; i < blockSize; i++) {
+        int32_t left;
+        int32_t right;
+        switch (assignment) {
+            case ChannelAssignment::LEFT_SIDE:
+                left = a[i];
+                right = a[i] - b[i];
+                break;
+            case ChannelAssignment::SIDE_RIGHT:
+                left = a[i] + b[i];
+                right = b[i];
+                break;
+            case ChannelAssignment::MID_SIDE: {
+                const int32_t mid = (a[i] << 1) | (b[i] & 1);
+                left = (mid + b[i]) >> 1;
+                right = (mid - b[i]) >> 1;
+                break;
+            }
+            default:
+                left = a[i];
+                right = b[i];
+                break;
+        }
+        packed[i] = uint16_t(left) | uint32_t(uint16_t(right)) << 16;
+    }
+
+    s_frameSample = header.sample;
+    s_frameSamples = MIN(blockSize, audio->totalSamples - header.sample);
+    return true;
+}
+
+// A frame passed while walking or playing refines the slot whose boundary it holds. Frames found by the SEEKTABLE
+// or probes only fill the next slot boundary after their start, if nothing better is known.
+static void recordSlot(AudioFile *audio, uint32_t offset, uint32_t sample, uint32_t samples) {
+    const uint32_t slot = (sample + samples - 1) >> c_slotShift;
+    if ((slot << c_slotShift) >= sample && slot < audio->slotCount) {
+        audio->slots[slot] = offset;
+    }
+}
+
+static void suggestSlot(AudioFile *audio, uint32_t offset, uint32_t sample) {
+    const uint32_t slot = (sample + (1u << c_slotShift) - 1) >> c_slotShift;
+    if (slot < audio->slotCount && !audio->slots[slot]) {
+        audio->slots[slot] = offset;
+    }
+}
+
+// Scans forward from the reader's byte aligned position for the header of the frame starting at sample (or of any
+// frame with c_anySample). Candidates need the sync code and a header that passes its CRC-8; the frame data in
+// between is skipped without being decoded. Leaves the reader after the header.
+static bool findFrame(const AudioFile *audio, uint32_t sample, uint32_t *offset, FrameHeader *header) {
+    const uint32_t limit = s_reader.tell() + audio->maxFrameBytes;
+    uint32_t previous = 0;
+    while (s_reader.tell() < limit && !s_reader.eof()) {
+        uint32_t value = s_reader.bits(8);
+        if (previous == 0xFF && (value & 0xFE) == 0xF8) {
+            const uint32_t candidate = s_reader.tell() - 2;
+            s_reader.seek(audio->fil, candidate);
+            if (readHeader(audio, header) && (sample == c_anySample || header->sample == sample)) {
+                *offset = candidate;
+                return true;
+            }
+            s_reader.seek(audio->fil, candidate + 2);
+            value = 0;
+        }
+        previous = value;
+    }
+    return false;
+}
+
+// Decodes the frame holding sample. Reading on continues from the last frame, anything else walks from the
+// nearest known slot, or from where an earlier walk stopped, skipping whole frames by their headers. A walk that
+// passes deadline (0 for none) stops with FR_TIMEOUT and the next call carries on from there.
+static FRESULT seekFrame(AudioFile *audio, uint32_t sample, uint64_t deadline) {
+    if (s_frameOwner == audio && sample >= s_frameSample && sample < s_frameSample + s_frameSamples) {
+        return FR_OK;
+    }
+
+    uint32_t slot = MIN(sample >> c_slotShift, audio->slotCount - 1);
+    while (!audio->slots[slot]) {
+        slot--;
+    }
+    // Slot entries start after the previous slot's boundary, so a walk past it is at worst a slot behind and going
+    // on with it keeps a walk that timed out moving forward
+    const uint32_t walkFloor = slot ? (slot - 1) << c_slotShift : 0;
+    const bool resume = s_walkOwner == audio && s_walkSample <= sample && s_walkSample > walkFloor;
+    if (!resume) {
+        s_walkOwner = audio;
+        s_walkOffset = audio->slots[slot];
+        s_walkSample = c_anySample;
+    }
+
+    while (true) {
+        FrameHeader header;
+        s_reader.seek(audio->fil, s_walkOffset);
+        const bool valid = readHeader(audio, &header) && header.sample <= sample &&
+                           (s_walkSample == c_anySample || header.sample == s_walkSample);
+        if (!valid) {
+            s_walkOwner = nullptr;
+            if (s_walkSample != c_anySample || slot == 0 || s_reader.eof()) {
+                return FR_INT_ERR;
+            }
+            audio->slots[slot] = 0;  // A bad SEEKTABLE entry or probe, try the slot before it
+            return seekFrame(audio, sample, deadline);
+        }
+
+        if (sample < header.sample + header.blockSize) {
+            s_frameOwner = nullptr;
+            if (!decodeFrame(audio, header)) {
+                s_walkOwner = nullptr;
+                return FR_INT_ERR;
+            }
+            recordSlot(audio, s_walkOffset, header.sample, header.blockSize);
+            s_frameOwner = audio;
+            s_walkOffset = s_reader.tell();
+            s_walkSample = header.sample + header.blockSize;
+            return FR_OK;
+        }
+
+        const uint32_t offset = s_walkOffset;
+        FrameHeader next;
+        if (!findFrame(audio, header.sample + header.blockSize, &s_walkOffset, &next)) {
+            s_walkOwner = nullptr;
+            return FR_INT_ERR;
+        }
+        recordSlot(audio, offset, header.sample, header.blockSize);
+        s_walkSample = next.sample;
+        if (deadline && time_us_64() > deadline) {
+            return FR_TIMEOUT;
+        }
+    }
+}
+
+static bool openWave(AudioFile *audio) {
+    FIL *fil = audio->fil;
+    const uint32_t fileSize = f_size(fil);
+    uint8_t header[16];
+    bool hasFormat = false;
+    uint32_t offset = 12;
+    while (offset + 8 <= fileSize) {
+        if (!readAt(fil, offset, header, 8)) {
+            return false;
+        }
+        const uint32_t chunkSize = readLE32(header + 4);
+        if (memcmp(header, "fmt ", 4) == 0) {
+            if (chunkSize < 16 || !readAt(fil, offset + 8, header, 16)) {
+                return false;
+            }
+            const uint16_t format = readLE16(header);
+            hasFormat = (format == 1 || format == 0xFFFE) && readLE16(header + 2) == 2 &&
+                        readLE32(header + 4) == 44100 && readLE16(header + 14) == 16;
+            if (!hasFormat) {
+                DEBUG_PRINT("WAVE: not 44.1 kHz 16-bit stereo PCM\n");
+                return false;
+            }
+        } else if (memcmp(header, "data", 4) == 0) {
+            audio->dataOffset = offset + 8;
+            audio->decodedSize = MIN(chunkSize, fileSize - audio->dataOffset);
+            return hasFormat;
+        }
+        offset += 8 + chunkSize + (chunkSize & 1);
+    }
+    return false;
+}
+
+// Seek points are relative to the first frame. They are not checked here, seekFrame drops a slot whose offset
+// does not hold a frame header. Returns the number of points used.
+static uint readSeekTable(AudioFile *audio, uint32_t offset, uint32_t length) {
+    uint8_t points[18 * 16];
+    const uint32_t fileSize = f_size(audio->fil);
+    uint used = 0;
+    for (uint32_t done = 0; done + 18 <= length;) {
+        const UINT chunk = MIN(uint32_t(sizeof(points)), (length - done) / 18 * 18);
+        if (!readAt(audio->fil, offset + done, points, chunk)) {
+            break;
+        }
+        for (UINT i = 0; i < chunk; i += 18) {
+            uint64_t sample = 0;
+            uint64_t frameOffset = 0;
+            for (int j = 0; j < 8; j++) {
+                sample = sample << 8 | points[i + j];
+                frameOffset = frameOffset << 8 | points[i + 8 + j];
+            }
+            if (sample < audio->totalSamples && audio->dataOffset + frameOffset < fileSize) {
+                suggestSlot(audio, audio->dataOffset + frameOffset, sample);
+                used++;
+            }
+        }
+        done += chunk;
+    }
+    return used;
+}
+
+// Without a SEEKTABLE, frames are looked for at byte positions spread over the file. A header only counts if the
+// next frame's header follows where it should, so a sync pattern in the audio data can't become a slot.
+static void probeSlots(AudioFile *audio) {
+    const uint32_t span = f_size(audio->fil) - audio->dataOffset;
+    const uint probes = MIN(audio->slotCount - 1, c_minProbes + audio->slotCount / 16);
+    for (uint i = 1; i <= probes; i++) {
+        s_reader.start(audio->fil, audio->dataOffset + uint64_t(span) * i / (probes + 1));
+        uint32_t offset;
+        uint32_t nextOffset;
+        FrameHeader header;
+        FrameHeader next;
+        if (findFrame(audio, c_anySample, &offset, &header) &&
+            (header.sample + header.blockSize >= audio->totalSamples ||
+             findFrame(audio, header.sample + header.blockSize, &nextOffset, &next))) {
+            suggestSlot(audio, offset, header.sample);
+        }
+    }
+}
+
+static bool openFlac(AudioFile *audio) {
+    FIL *fil = audio->fil;
+    uint8_t block[34];
+    uint32_t offset = 4;
+    uint32_t seekTableOffset = 0;
+    uint32_t seekTableLength = 0;
+    bool last = false;
+    bool hasStreamInfo = false;
+    while (!last) {
+        if (!readAt(fil, offset, block, 4)) {
+            return false;
+        }
+        last = block[0] & 0x80;
+        const uint8_t type = block[0] & 0x7F;
+        const uint32_t length = block[1] << 16 | block[2] << 8 | block[3];
+        if (type == 0) {
+            if (length < sizeof(block) || !readAt(fil, offset + 4, block, sizeof(block))) {
+                return false;
+            }
+            const uint32_t maxBlockSize = block[2] << 8 | block[3];
+            const uint32_t maxFrameBytes = block[7] << 16 | block[8] << 8 | block[9];
+            const uint32_t sampleRate = block[10] << 12 | block[11] << 4 | block[12] >> 4;
+            const uint channels = ((block[12] >> 1) & 7) + 1;
+            const uint bps = (((block[12] & 1) << 4) | (block[13] >> 4)) + 1;
+            const uint64_t totalSamples = uint64_t(block[13] & 0x0F) << 32 |
+                                          uint32_t(block[14] << 24 | block[15] << 16 | block[16] << 8 | block[17]);
+            if (sampleRate != 44100 || channels != 2 || bps != 16 || maxBlockSize > c_maxBlockSize ||
+                totalSamples == 0 || totalSamples * 4 > 0xFFFFFFFF) {
+                DEBUG_PRINT("FLAC: not 44.1 kHz 16-bit stereo\n");
+                return false;
+            }
+            audio->blockSize = maxBlockSize;
+            audio->maxFrameBytes = maxFrameBytes ? maxFrameBytes + 16 : maxBlockSize * 5 + 64;  // 0 is unknown
+            audio->totalSamples = totalSamples;
+            hasStreamInfo = true;
+        } else if (type == 3) {
+            seekTableOffset = offset + 4;
+            seekTableLength = length;
+        }
+        offset += 4 + length;
+    }
+    if (!hasStreamInfo || !readAt(fil, offset, block, 2) || block[0] != 0xFF || (block[1] & 0xFE) != 0xF8) {
+        return false;
+    }
+    audio->dataOffset = offset;
+    audio->variableBlockSize = block[1] & 1;
+    audio->decodedSize = audio->totalSamples * 4;
+
+    // The frame buffer grows to the largest block size of the image's FLAC files
+    if (audio->blockSize > s_blockCapacity) {
+        free(s_channels);
+        s_frameOwner = nullptr;
+        s_channels = (int32_t *)malloc(audio->blockSize * 2 * sizeof(int32_t));
+        s_blockCapacity = s_channels ? audio->blockSize : 0;
+    }
+    audio->slotCount = ((audio->totalSamples - 1) >> c_slotShift) + 1;
+    audio->slots = (uint32_t *)calloc(audio->slotCount, sizeof(uint32_t));
+    if (!s_channels || !audio->slots) {
+        DEBUG_PRINT("FLAC: out of memory\n");
+        return false;
+    }
+    audio->slots[0] = audio->dataOffset;
+
+    uint points = 0;
+    if (seekTableLength) {
+        points = readSeekTable(audio, seekTableOffset, seekTableLength);
+    }
+    if (!points) {
+        probeSlots(audio);
+    }
+    DEBUG_PRINT("FLAC: %lu samples, %lu slots, %u seek points\n", audio->totalSamples, audio->slotCount, points);
+    return true;
+}
+
+static AudioFile *find(const CueFile *file) {
+    for (AudioFile *audio = s_files; audio; audio = audio->next) {
+        if (audio->file == file) {
+            return audio;
+        }
+    }
+    return nullptr;
+}
+
+static void audioSize(CueFile *file, CueScheduler *scheduler, [[maybe_unused]] int compressed,
+                      void (*cb)(CueFile *, CueScheduler *, uint64_t)) {
+    File_schedule_size(file, scheduler, find(file)->decodedSize, cb);
+}
+
+bool picostation::audiofile::attach(CueFile *file, [[maybe_unused]] const TCHAR *path) {  // For the log
+    FIL *fil = (FIL *)file->opaque;
+    uint8_t magic[12];
+    if (!readAt(fil, 0, magic, sizeof(magic))) {
+        return false;
+    }
+    const bool wave = memcmp(magic, "RIFF", 4) == 0 && memcmp(magic + 8, "WAVE", 4) == 0;
+    const bool flac = memcmp(magic, "fLaC", 4) == 0;
+    AudioFile *audio = (wave || flac) ? (AudioFile *)calloc(1, sizeof(AudioFile)) : nullptr;
+    if (!audio) {
+        f_lseek(fil, 0);
+        return false;
+    }
+
+    audio->file = file;
+    audio->fil = fil;
+    audio->format = wave ? AudioFormat::WAVE : AudioFormat::FLAC;
+    const bool ok = wave ? openWave(audio) : openFlac(audio);
+    f_lseek(fil, 0);
+    if (!ok) {
+        free(audio->slots);
+        free(audio);
+        return false;
+    }
+
+    DEBUG_PRINT("%s: %lu bytes of audio\n", path, audio->decodedSize);
+    file->size = audioSize;
+    audio->next = s_files;
+    s_files = audio;
+    return true;
+}
+
+bool picostation::audiofile::isAttached(const CueFile *file) { return find(file) != nullptr; }
+
+FRESULT picostation::audiofile::read(const CueFile *file, uint64_t offset, void *buffer, UINT length,
+                                     UINT *bytesRead, uint64_t deadline) {
+    AudioFile *audio = find(file);
+    *bytesRead = 0;
+    if (offset >= audio->decodedSize) {
+        return FR_OK;
+    }
+    length = MIN(uint64_t(length), audio->decodedSize - offset);
+
+    if (audio->format == AudioFormat::WAVE) {
+        FRESULT fr = f_lseek(audio->fil, audio->dataOffset + offset);
+        if (fr != FR_OK) {
+            return fr;
+        }
+        return f_read(audio->fil, buffer, length, bytesRead);
+    }
+
+    uint8_t *destination = (uint8_t *)buffer;
+    while (length > 0) {
+        const FRESULT fr = seekFrame(audio, offset / 4, deadline);
+        if (fr != FR_OK) {
+            return fr;
+        }
+        const uint32_t start = offset - s_frameSample * 4;
+        const UINT chunk = MIN(length, s_frameSamples * 4 - start);
+        memcpy(destination, reinterpret_cast<const uint8_t *>(s_channels) + start, chunk);
+        *bytesRead += chunk;
+        offset += chunk;
+        destination += chunk;
+        length -= chunk;
+    }
+    return FR_OK;
+}
+
+void picostation::audiofile::reset() {
+    while (s_files) {
+        AudioFile *next = s_files->next;
+        free(s_files->slots);
+        free(s_files);
+        s_files = next;
+    }
+    free(s_channels);
+    s_channels = nullptr;
+    s_blockCapacity = 0;
+    s_frameOwner = nullptr;
+    s_walkOwner = nullptr;
+}
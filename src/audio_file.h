@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "../third_party/cueparser/fileabstract.h"
+#include "ff.h"
+
+namespace picostation {
+namespace audiofile {
+// Serves WAVE and FLAC track files as the raw 44.1 kHz 16-bit stereo PCM a BINARY track would hold. WAVE files
+// are read past their header, FLAC files are decoded a frame at a time. Seeks start from a known frame every 65536
+// samples, taken from the SEEKTABLE or probed at load, and skip the frames up to the one they need by their
+// headers without decoding them.
+// Returns false, leaving the file untouched, if it is not a WAVE/FLAC file in CD audio format.
+bool attach(struct CueFile *file, const TCHAR *path);
+bool isAttached(const struct CueFile *file);
+// A FLAC seek still walking at deadline (time_us_64, 0 for none) returns FR_TIMEOUT; reading the same offset
+// again carries on where it stopped.
+FRESULT read(const struct CueFile *file, uint64_t offset, void *buffer, UINT length, UINT *bytesRead,
+             uint64_t deadline = 0);
+void reset();  // Forget all attached files, call before loading another image
+}  // namespace audiofile
+}  // namespace picostation
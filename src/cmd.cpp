@@ -3,11 +3,13 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include "hardware/irq.h"
 #include "hardware/pio.h"
 #include "logging.h"
 #include "main.pio.h"
 #include "pico/stdlib.h"
 #include "picostation.h"
+#include "seek_model.h"
 #include "utils.h"
 #include "values.h"
 
@@ -93,10 +95,10 @@ static inline void picostation::mechcommand::audioControl(const uint latched) {
     }
 
     g_audioCtrlMode = (latched & (pct1_bit | pct2_bit)) >> 14;
-    /*switch (g_audioCtrlMode) {
+    switch (g_audioCtrlMode) {
         case audioControlModes::NORMAL:
         case audioControlModes::ALTNORMAL:
-            g_audioPeak = 0;
+            g_audioPeakResets = g_audioPeakResets + 1;  // core1 owns the peak and clears it on its next sector
             DEBUG_PRINT("NORMAL\n");
             break;
 
@@ -107,7 +109,7 @@ static inline void picostation::mechcommand::audioControl(const uint latched) {
         case audioControlModes::PEAKMETER:
             DEBUG_PRINT("PEAKMETER\n");
             break;
-    }*/
+    }
 }
 
 static inline void picostation::mechcommand::autoSequence(const uint latched)  // $4X
@@ -168,14 +170,17 @@ static inline void picostation::mechcommand::autoSequence(const uint latched)  /
         s_autoSeqTrack = g_track + tracks_to_move;
     }
 
+    // Let core1 start reading the destination while the seek delay runs
+    g_prefetchSector = seekmodel::trackToSector(clamp(s_autoSeqTrack, c_trackMin, c_trackMax));
+
     if (!s_autoSeqAlarmID) {
-        s_autoSeqAlarmID = add_alarm_in_ms(
-            15,
+        s_autoSeqAlarmID = add_alarm_in_us(
+            seekmodel::jumpDelayUs(g_track, s_autoSeqTrack, g_targetPlaybackSpeed),
             [](alarm_id_t id, void *user_data) -> int64_t {
                 const int track = *(int *)user_data;
                 s_autoSeqAlarmID = 0;
                 g_track = clamp(track, c_trackMin, c_trackMax);
-                g_sectorForTrackUpdate = trackToSector(g_track);
+                g_sectorForTrackUpdate = seekmodel::trackToSector(g_track);
                 g_sector = g_sectorForTrackUpdate;
                 s_sensData[SENS::XBUSY] = 0;
                 return 0;
@@ -228,12 +233,12 @@ static inline void picostation::mechcommand::trackingMode(const uint latched)  /
     {
         case 8:  // Forward track jump
             g_track = clamp(g_track + 1, c_trackMin, c_trackMax);
-            g_sectorForTrackUpdate = trackToSector(g_track);
+            g_sectorForTrackUpdate = seekmodel::trackToSector(g_track);
             g_sector = g_sectorForTrackUpdate;
             break;
         case 0xC:  // Reverse track jump
             g_track = clamp(g_track - 1, c_trackMin, c_trackMax);
-            g_sectorForTrackUpdate = trackToSector(g_track);
+            g_sectorForTrackUpdate = seekmodel::trackToSector(g_track);
             g_sector = g_sectorForTrackUpdate;
             break;
     }
@@ -253,7 +258,7 @@ static inline void picostation::mechcommand::trackingMode(const uint latched)  /
 
         default:  // case 0: case 1: // sled servo off/on
             if (g_sledMoveDirection != SledMove::STOP) {
-            g_sectorForTrackUpdate = trackToSector(g_track);
+            g_sectorForTrackUpdate = seekmodel::trackToSector(g_track);
             g_sector = g_sectorForTrackUpdate;
             }
             g_sledMoveDirection = SledMove::STOP;
@@ -304,6 +309,7 @@ static inline void picostation::mechcommand::spindleControl(const uint latched)
 }
 
 void __time_critical_func(picostation::mechcommand::interrupt_xlat)(uint gpio, uint32_t events) {
+    updateMechSens();  // The command's last byte may still be in the FIFO
     const uint latched = s_latched;
     const uint command = (latched & 0xF00000) >> 20;
     s_latched = 0;
@@ -382,10 +388,21 @@ void __time_critical_func(picostation::mechcommand::setSens)(const uint what, co
 
 void __time_critical_func(picostation::mechcommand::updateMechSens)() {
     while (!pio_sm_is_rx_fifo_empty(PIOInstance::MECHACON, SM::MECHACON)) {
-        uint c = pio_sm_get_blocking(PIOInstance::MECHACON, SM::MECHACON) >> 24;
+        uint c = pio_sm_get(PIOInstance::MECHACON, SM::MECHACON) >> 24;
         s_latched = s_latched >> 8;
         s_latched = s_latched | (c << 16);
         s_currentSens = c >> 4;
         gpio_put(Pin::SENS, s_sensData[c >> 4]);
     }
-}
\ No newline at end of file
+}
+
+// Every byte is taken as it arrives, SENS follows its address nibble without either main loop polling. Runs on
+// the core that calls this, the same one as the XLAT handler, so the command state needs no lock.
+void picostation::mechcommand::enableCaptureIRQ() {
+    const uint irq = pio_get_index(PIOInstance::MECHACON) ? PIO1_IRQ_0 : PIO0_IRQ_0;
+    pio_set_irq0_source_enabled(PIOInstance::MECHACON,
+                                (pio_interrupt_source)(pis_sm0_rx_fifo_not_empty + SM::MECHACON), true);
+    irq_set_exclusive_handler(irq, updateMechSens);
+    irq_set_priority(irq, PICO_HIGHEST_IRQ_PRIORITY);  // Ahead of XLAT on GPIO
+    irq_set_enabled(irq, true);
+}
@@ -5,9 +5,10 @@
 namespace picostation {
 namespace mechcommand {
 
+void enableCaptureIRQ();
 bool getSens(const uint what);
 void interrupt_xlat(uint gpio, uint32_t events);
 void setSens(const uint what, const bool new_value);
-void updateMechSens();
+void updateMechSens();  // Drains the command FIFO, the capture IRQ handler
 }  // namespace mechcommand
 }  // namespace picostation
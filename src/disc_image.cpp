@@ -6,8 +6,12 @@
 #include <string.h>
 
 #include "../third_party/posix_file.h"
+#include "audio_file.h"
+#include "ecm.h"
+#include "edc_ecc.h"
 #include "f_util.h"
 #include "ff.h"
+#include "ff_stdio.h"
 #include "logging.h"
 #include "pico/stdlib.h"
 #include "picostation.h"
@@ -29,7 +33,8 @@ struct MSF {
 
 picostation::DiscImage picostation::g_discImage;
 
-static constexpr uint16_t crc16_lut[256] = {
+// Read by core0 for every SubQ frame, kept beside its stack in scratch_y rather than behind the XIP cache
+static const uint16_t __scratch_y("crc16_lut") crc16_lut[256] = {
     0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7, 0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad,
     0xe1ce, 0xf1ef, 0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6, 0x9339, 0x8318, 0xb37b, 0xa35a,
     0xd3bd, 0xc39c, 0xf3ff, 0xe3de, 0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485, 0xa56a, 0xb54b,
@@ -50,7 +55,7 @@ static constexpr uint16_t crc16_lut[256] = {
     0x1ce0, 0x0cc1, 0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8, 0x6e17, 0x7e36, 0x4e55, 0x5e74,
     0x2e93, 0x3eb2, 0x0ed1, 0x1ef0};
 
-static MSF sectorToMSF(const int sector) {
+static MSF __time_critical_func(sectorToMSF)(const int sector) {
     MSF msf;
     msf.mm = abs(sector / 75 / 60);
     msf.ss = abs((sector / 75) % 60);
@@ -80,7 +85,7 @@ static void getParentPath(const TCHAR *path, TCHAR *parentPath) {
     }
 }
 
-picostation::SubQ::Data picostation::DiscImage::generateSubQ(const int sector) {
+picostation::SubQ::Data __time_critical_func(picostation::DiscImage::generateSubQ)(const int sector) {
     SubQ::Data subqdata;
 
     int sector_track;
@@ -152,7 +157,7 @@ picostation::SubQ::Data picostation::DiscImage::generateSubQ(const int sector) {
         if (sector - c_leadIn < c_preGap) {
             m_currentLogicalTrack = 1;
         } else {
-            for (int i = 1; i < m_cueDisc.trackCount + 2; i++) {  // + 2 for lead in & lead out
+            for (int i = 1; i <= m_cueDisc.trackCount; i++) {  // Past the last track it stays the lead-out
                 if (m_cueDisc.tracks[i + 1].indices[0] > sector - c_leadIn - c_preGap) {
                     m_currentLogicalTrack = i;
                     break;
@@ -190,6 +195,11 @@ picostation::SubQ::Data picostation::DiscImage::generateSubQ(const int sector) {
         subqdata.aframe = toBCD(msf_abs.ff);
     }
 
+    const int override = m_subqOverrides.find(sector);
+    if (override >= 0) {
+        m_subqOverrides.apply(override, &subqdata);
+    }
+
     subqdata.crc = 0;
     switch (g_audioCtrlMode) {
         case audioControlModes::NORMAL:
@@ -200,17 +210,25 @@ picostation::SubQ::Data picostation::DiscImage::generateSubQ(const int sector) {
             }
             subqdata.crc = (subqdata.crc << 8) | (subqdata.crc >> 8);  // swap endianness
             // There's probably a better way to do this in the calculation, but I'm sleepy
+            if (override >= 0) {
+                m_subqOverrides.applyCRC(override, &subqdata);
+            }
             break;
 
-        case audioControlModes::LEVELMETER:
-            // subqdata.crc = g_audioLevel;
-            subqdata.raw[11] = ((sector % 2) == 0) ? 0x00 : 0x80;
+        // The meters replace the CRC, low byte first. The level meter alternates channels, bit 15 says which.
+        case audioControlModes::LEVELMETER: {
+            const int32_t level = g_audioLevel;
+            subqdata.raw[10] = level & 0xFF;
+            subqdata.raw[11] = (level >> 8) & 0xFF;
             break;
+        }
 
-        case audioControlModes::PEAKMETER:
-            // subqdata.crc = g_audioPeak;
-            subqdata.crc = 0xbeef;
+        case audioControlModes::PEAKMETER: {
+            const int32_t peak = g_audioPeak;
+            subqdata.raw[10] = peak & 0xFF;
+            subqdata.raw[11] = (peak >> 8) & 0x7F;
             break;
+        }
     }
 
     return subqdata;
@@ -242,12 +260,70 @@ static struct CueFile *fileopen(struct CueFile *file, struct CueScheduler *sched
     strcpy(fullpath, context->parentPath);
     strcat(fullpath, "/");
     strcat(fullpath, filename);
-    return create_posix_file(file, fullpath, "r");
+    if (create_posix_file(file, fullpath, "r")) {
+        picostation::audiofile::attach(file, fullpath);  // WAVE and FLAC tracks are served as raw PCM
+        return file;
+    }
+
+    // Fall back to an ECM-encoded copy of the file
+    strcat(fullpath, ".ecm");
+    if (!create_posix_file(file, fullpath, "r")) {
+        return NULL;
+    }
+    if (!picostation::ecm::attach(file, fullpath)) {
+        DEBUG_PRINT("Invalid ECM file: %s\n", fullpath);
+        ff_fclose((FIL *)file->opaque);
+        file->opaque = NULL;
+        return NULL;
+    }
+    return file;
+}
+
+// Reads from the track's file, decoding it if it is ECM-encoded or compressed audio
+static FRESULT __time_critical_func(readFile)(const struct CueFile *file, int64_t offset, void *buffer, UINT length,
+                                              UINT *bytesRead, uint64_t deadline) {
+    if (picostation::ecm::isAttached(file)) {
+        return picostation::ecm::read(file, offset, buffer, length, bytesRead);
+    }
+    if (picostation::audiofile::isAttached(file)) {
+        return picostation::audiofile::read(file, offset, buffer, length, bytesRead, deadline);
+    }
+
+    FRESULT fr = f_lseek((FIL *)file->opaque, offset);
+    if (FR_OK != fr) {
+        DEBUG_PRINT("f_lseek(%s) error: (%d)\n", FRESULT_str(fr), fr);
+        return fr;  // Reading from wherever the file was left would send the wrong sector
+    }
+    return f_read((FIL *)file->opaque, buffer, length, bytesRead);
+}
+
+// The parser allocates a CueFile per FILE line and tracks sharing a file are consecutive
+void picostation::DiscImage::releaseFiles() {
+    struct CueFile *previous = nullptr;
+    for (int i = 1; i <= m_cueDisc.trackCount; i++) {
+        struct CueFile *file = m_cueDisc.tracks[i].file;
+        if (file && file != previous) {
+            if (file->opaque) {
+                ff_fclose((FIL *)file->opaque);
+            }
+            free(file);
+        }
+        previous = file;
+    }
+    m_cueDisc.trackCount = 0;
 }
 
 FRESULT picostation::DiscImage::load(const TCHAR *targetCue) {
+#if DEBUG_CUE
+    const uint64_t parseStart = time_us_64();
+    Scheduler_resetClosureStats();
+#endif
     struct CueScheduler scheduler;
     Scheduler_construct(&scheduler);
+    ecm::reset();
+    audiofile::reset();
+    releaseFiles();  // Freed together before the new ones are allocated, so reloads don't fragment the heap
+    m_failedReadsInRow = 0;
     Context context;
     getParentPath(targetCue, context.parentPath);
     scheduler.opaque = &context;
@@ -263,14 +339,39 @@ FRESULT picostation::DiscImage::load(const TCHAR *targetCue) {
     CueParser_parse(&parser, &cue, &scheduler, fileopen, parser_cb);
     Scheduler_run(&scheduler);
     CueParser_close(&parser, &scheduler, close_cb);
+    Scheduler_run(&scheduler);
+    if (cue.opaque) {
+        ff_fclose((FIL *)cue.opaque);
+    }
 
+#if DEBUG_CUE
+    const CueClosureStats closureStats = Scheduler_getClosureStats();
+    DEBUG_PRINT("Parsed in %u us, %u closures (%u from the heap), peak %u in use\n",
+                (unsigned)(time_us_64() - parseStart), (unsigned)closureStats.allocations,
+                (unsigned)closureStats.heapFallbacks, (unsigned)closureStats.peakInUse);
+#endif
     DEBUG_PRINT("Disc track count: %d\n", m_cueDisc.trackCount);
 
-    // Lead-out
+    // Lead-out, a track's size counts from its INDEX 00
     m_cueDisc.tracks[m_cueDisc.trackCount + 1].fileOffset =
-        m_cueDisc.tracks[m_cueDisc.trackCount].indices[1] + m_cueDisc.tracks[m_cueDisc.trackCount].size;
+        m_cueDisc.tracks[m_cueDisc.trackCount].indices[0] + m_cueDisc.tracks[m_cueDisc.trackCount].size;
     m_cueDisc.tracks[m_cueDisc.trackCount + 1].indices[0] = m_cueDisc.tracks[m_cueDisc.trackCount + 1].fileOffset;
     m_cueDisc.tracks[m_cueDisc.trackCount + 1].indices[1] = m_cueDisc.tracks[m_cueDisc.trackCount + 1].indices[0];
+    m_cueDisc.tracks[m_cueDisc.trackCount + 1].sectorSize = 2352;
+
+    m_subqOverrides.load(targetCue);
+
+    // Generated data sectors use the mode of the disc's first data sector
+    m_dataMode = 2;
+    if (m_cueDisc.tracks[1].trackType == CueTrackType::TRACK_TYPE_DATA) {
+        readData(m_syntheticSector, 0);
+        const uint8_t mode = reinterpret_cast<const uint8_t *>(m_syntheticSector)[15];
+        if (mode == 1 || mode == 2) {
+            m_dataMode = mode;
+        }
+    }
+    memset(m_syntheticSector, 0, sizeof(m_syntheticSector));
+    m_syntheticIsData = false;
 
     m_hasData = false;
     DEBUG_PRINT("Track\tStart\tLength\tPregap\n");
@@ -285,38 +386,133 @@ FRESULT picostation::DiscImage::load(const TCHAR *targetCue) {
     return FR_OK;
 }
 
-void picostation::DiscImage::readData(void *buffer, const int sector) {
+bool __time_critical_func(picostation::DiscImage::readData)(void *buffer, const int sector) {
     FRESULT fr;
     UINT br = 0;
+    UINT expected = c_cdSamplesBytes;
+    uint8_t *destination = (uint8_t *)buffer;
 
-    for (int i = 1; i <= m_cueDisc.trackCount + 1; i++) {
+    for (int i = 1; i <= m_cueDisc.trackCount; i++) {
         if (sector < m_cueDisc.tracks[i + 1].indices[0]) {
             if (m_cueDisc.tracks[i].file->opaque) {
-                int64_t seekBytes = (sector - m_cueDisc.tracks[i].fileOffset) * 2352LL;
-                if (seekBytes >= 0) {
-                    fr = f_lseek((FIL *)m_cueDisc.tracks[i].file->opaque, seekBytes);
-                    if (FR_OK != fr) {
-                        f_rewind((FIL *)m_cueDisc.tracks[i].file->opaque);
-                        // panic("f_lseek(%s) error: (%d)\n", FRESULT_str(fr), fr);
-                        DEBUG_PRINT("f_lseek(%s) error: (%d)\n", FRESULT_str(fr), fr);
-                    }
+                // Cooked sectors are read in place after the sync/header and the rest is rebuilt below
+                const uint32_t sectorSize = m_cueDisc.tracks[i].sectorSize;
+                int64_t seekBytes = (int64_t)(sector - m_cueDisc.tracks[i].fileOffset) * sectorSize;
+                if (seekBytes < 0) {
+                    break;
                 }
 
-                fr = f_read((FIL *)m_cueDisc.tracks[i].file->opaque, buffer, c_cdSamplesBytes, &br);
-                if (FR_OK != fr) {
-                    // panic("f_read(%s) error: (%d)\n", FRESULT_str(fr), fr);
-                    DEBUG_PRINT("f_read(%s) error: (%d)\n", FRESULT_str(fr), fr);
-                } else if (br != c_cdSamplesBytes) {
-                    // DEBUG_PRINT("Logical track: %d, sector: %d, read: %d\n", i, sector, br);
-                    // DEBUG_PRINT("Seek bytes: %llu\n", seekBytes);
-                    // DEBUG_PRINT("f_read(%s) error: (%d) read: %d\n", FRESULT_str(fr), fr, br);
+                if (sectorSize != c_cdSamplesBytes) {
+                    destination += 16;
+                    expected = sectorSize;
+                }
+                // A glitch usually clears on the next attempt, as long as one fits before the deadline
+                const uint64_t readStart = time_us_64();
+                for (int attempt = 1;; attempt++) {
+                    br = 0;
+                    fr = readFile(m_cueDisc.tracks[i].file, seekBytes, destination, expected, &br, m_readDeadline);
+                    // A FLAC seek that ran out of time resumes on the next read of the sector, not in this one
+                    if (FR_OK == fr || FR_TIMEOUT == fr || attempt == c_maxReadAttempts) {
+                        break;
+                    }
+                    const uint64_t now = time_us_64();
+                    if (m_readDeadline && now + (now - readStart) / attempt > m_readDeadline) {
+                        break;
+                    }
+                    m_readStats.retries++;
+                }
+                m_readStats.reads++;
+                if (FR_TIMEOUT == fr) {
+                    br = 0;  // Not the card's fault, so it doesn't count towards a remount
+                } else if (FR_OK != fr) {
+                    DEBUG_PRINT("f_read(%s) error: (%d), sector %d\n", FRESULT_str(fr), fr, sector);
+                    m_readStats.failures++;
+                    m_failedReadsInRow++;
+                    br = 0;
+                } else {
+                    m_failedReadsInRow = 0;
+                }
+                if (br < expected) {
+                    memset(destination + br, 0, expected - br);  // Past the end of a truncated image, or failed
+                }
+                if (sectorSize == 2048) {
+                    edcecc::buildMode1((uint8_t *)buffer, sector);
+                } else if (sectorSize == 2336) {
+                    edcecc::buildMode2((uint8_t *)buffer, sector);
                 }
-                break;
+                return FR_OK == fr;
             }
         }
     }
-    if (br < c_cdSamplesBytes) {
-        memset((uint8_t *)buffer + br, 0, c_cdSamplesBytes - br);
-    }
+    memset(buffer, 0, c_cdSamplesBytes);
     // DEBUG_PRINT("Sector not found: %d\n", sector);
-}
\ No newline at end of file
+    return true;
+}
+
+// Returns the track whose type the sector takes, or -1 if the sector is read from the image
+int __time_critical_func(picostation::DiscImage::syntheticTrack)(const int sector) const {
+    const int discSector = sector - c_leadIn - c_preGap;
+    if (discSector < 0) {
+        return 1;  // Lead-in and track 1 pregap
+    }
+    for (int i = 1; i <= m_cueDisc.trackCount; i++) {
+        const int nextTrack = m_cueDisc.tracks[i + 1].indices[0];
+        if (discSector < nextTrack) {
+            // fileOffset can't tell a PREGAP apart when the previous track shares the file, it moved past it
+            const CueTrack &track = m_cueDisc.tracks[i];
+            const int index1 = track.indices[1];
+            if ((discSector < index1 && discSector >= index1 - (int)track.pregap) ||
+                discSector >= nextTrack - (int)track.postgap) {
+                return i;  // PREGAP/POSTGAP
+            }
+            return -1;
+        }
+    }
+    return m_cueDisc.trackCount;  // Lead-out
+}
+
+bool picostation::DiscImage::locate(const int lba, Location *location) const {
+    if (lba < 0 || lba >= sectorCount() || isSynthetic(lba + c_leadIn + c_preGap)) {
+        return false;
+    }
+    int file = -1;
+    const struct CueFile *previous = nullptr;
+    for (int i = 1; i <= m_cueDisc.trackCount; i++) {
+        const CueTrack &track = m_cueDisc.tracks[i];
+        if (track.file != previous) {
+            file++;
+            previous = track.file;
+        }
+        if (lba < (int)m_cueDisc.tracks[i + 1].indices[0]) {
+            location->file = file;
+            location->index = lba - track.fileOffset;
+            location->sectorSize = track.sectorSize;
+            location->isData = track.trackType == CueTrackType::TRACK_TYPE_DATA;
+            location->encoded = ecm::isAttached(track.file) || audiofile::isAttached(track.file);
+            return true;
+        }
+    }
+    return false;
+}
+
+const uint16_t *__time_critical_func(picostation::DiscImage::syntheticSector)(const int sector, bool *isData) {
+    const int track = syntheticTrack(sector);
+    if (track < 0) {
+        return nullptr;
+    }
+
+    uint8_t *data = reinterpret_cast<uint8_t *>(m_syntheticSector);
+    *isData = m_cueDisc.tracks[track].trackType == CueTrackType::TRACK_TYPE_DATA;
+    if (*isData) {
+        // Only the header changes from sector to sector, the user data stays zero
+        if (m_dataMode == 1) {
+            edcecc::buildMode1(data, sector - c_leadIn - c_preGap);
+        } else {
+            edcecc::buildMode2(data, sector - c_leadIn - c_preGap);
+        }
+    } else if (m_syntheticIsData) {
+        memset(data, 0, c_cdSamplesBytes);
+    }
+    m_syntheticIsData = *isData;
+    return m_syntheticSector;
+}
@@ -8,10 +8,21 @@
 #include "../third_party/posix_file.h"
 #include "ff.h"
 #include "subq.h"
+#include "subq_override.h"
+#include "values.h"
 
 namespace picostation {
 class DiscImage {
   public:
+    static constexpr int c_maxReadAttempts = 3;
+    static constexpr uint32_t c_remountFailures = 3;  // Failed reads in a row before the card is thought gone
+
+    struct ReadStats {
+        uint32_t reads;
+        uint32_t retries;
+        uint32_t failures;  // Reads that still failed after their retries, the sector went out zero-filled
+    };
+
     DiscImage() {};
     ~DiscImage() {};
 
@@ -21,12 +32,46 @@ class DiscImage {
     bool isCurrentTrackData() {
         return m_cueDisc.tracks[m_currentLogicalTrack].trackType == CueTrackType::TRACK_TYPE_DATA;
     };
-    void readData(void *buffer, const int sector);
+    // False if the file read failed, the buffer is zero-filled then and must not be kept
+    bool readData(void *buffer, const int sector);
+
+    // Retries stop when another attempt would end past this time_us_64() value, 0 lifts the limit
+    void setReadDeadline(const uint64_t deadline) { m_readDeadline = deadline; }
+    bool needsRemount() const { return m_failedReadsInRow >= c_remountFailures; }  // Reload after remounting
+    ReadStats getReadStats() const { return m_readStats; }
+    void resetReadStats() { m_readStats = {}; }
+
+    // Lead-in, track 1 pregap, cue PREGAP/POSTGAP and lead-out sectors are not in the image files. They are
+    // generated here instead: digital silence in audio areas, zero-filled data sectors in data areas.
+    // sector is absolute (lead-in included). Returns nullptr for sectors that are read from the image.
+    bool isSynthetic(const int sector) const { return syntheticTrack(sector) >= 0; }
+    const uint16_t *syntheticSector(const int sector, bool *isData);
+
+    // Where a disc-relative sector's bytes come from, for walking the image outside of play
+    struct Location {
+        int file;             // Ordinal of the FILE line in the cue sheet
+        int index;            // Sector within that file
+        uint32_t sectorSize;  // As stored, readData puts cooked sectors at offset 16
+        bool isData;
+        bool encoded;  // ECM, WAVE or FLAC: the stored bytes are not what readData returns
+    };
+    int sectorCount() const { return m_cueDisc.tracks[m_cueDisc.trackCount + 1].indices[0]; }  // Up to the lead-out
+    bool locate(const int lba, Location *location) const;  // False for generated sectors
 
   private:
+    int syntheticTrack(const int sector) const;
+    void releaseFiles();  // Closes and frees the current image's track files
+
     CueDisc m_cueDisc;
     bool m_hasData = false;
     int m_currentLogicalTrack = 0;
+    SubQOverrides m_subqOverrides;
+    uint8_t m_dataMode = 2;  // Of the generated data sectors, taken from the first one of track 1
+    bool m_syntheticIsData = false;
+    uint64_t m_readDeadline = 0;
+    uint32_t m_failedReadsInRow = 0;
+    ReadStats m_readStats = {};
+    uint16_t m_syntheticSector[c_cdSamplesBytes / sizeof(uint16_t)] = {0};
 };
 
 extern DiscImage g_discImage;
@@ -0,0 +1,374 @@
+#include "ecm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "edc_ecc.h"
+#include "f_util.h"
+#include "logging.h"
+#include "pico/stdlib.h"
+
+#if DEBUG_CUE
+#define DEBUG_PRINT(...) printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINT(...) while (0)
+#endif
+
+namespace RecordType {
+enum : uint8_t {
+    RAW = 0,           // Bytes stored as is
+    MODE1 = 1,         // 3 address bytes + 2048 data -> 2352 byte sector
+    MODE2_FORM1 = 2,   // 4 subheader bytes + 2048 data -> 2336 bytes from the subheader on
+    MODE2_FORM2 = 3,   // 4 subheader bytes + 2324 data -> 2336 bytes from the subheader on
+};
+}
+
+static constexpr uint32_t c_inUnit[] = {1, 3 + 2048, 4 + 2048, 4 + 2324};
+static constexpr uint32_t c_outUnit[] = {1, 2352, 2336, 2336};
+
+static constexpr uint c_maxCheckpoints = 1024;  // Per file, longer files get a record stride between them
+static constexpr uint32_t c_indexMagic = 0x49434d45;  // "ECMI"
+static constexpr uint32_t c_indexVersion = 1;
+
+struct Checkpoint {
+    uint32_t inOffset;  // Of the record header
+    uint32_t outOffset;
+};
+
+struct Record {
+    uint32_t dataOffset;
+    uint32_t outOffset;
+    uint32_t count;
+    uint32_t nextOffset;  // Header of the following record
+    uint8_t type;
+
+    uint32_t outEnd() const { return outOffset + count * c_outUnit[type]; }
+};
+
+struct IndexHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t ecmSize;
+    uint32_t decodedSize;
+    uint32_t stride;
+    uint32_t count;
+};
+
+// One per attached file, allocated with its checkpoint table at attach and freed by reset()
+struct EcmFile {
+    EcmFile *next;
+    const CueFile *file;
+    FIL *fil;
+    uint32_t decodedSize;
+    uint32_t stride;  // Records per checkpoint
+    uint32_t count;
+    Checkpoint *checkpoints;
+    Record current;
+    bool currentValid;
+};
+
+static EcmFile *s_files = nullptr;
+static uint8_t *s_sector = nullptr;  // 2352 bytes, allocated with the first ECM file
+
+static bool readAt(FIL *fil, uint32_t offset, void *buffer, UINT length) {
+    UINT br;
+    if (f_tell(fil) != offset && f_lseek(fil, offset) != FR_OK) {
+        return false;
+    }
+    return f_read(fil, buffer, length, &br) == FR_OK && br == length;
+}
+
+// Header: bits 0-1 type, then the count - 1 in 5 + 7n bits, bit 7 of every byte flags a continuation
+static bool readRecord(FIL *fil, uint32_t inOffset, uint32_t outOffset, Record *record) {
+    uint8_t header[5];
+    UINT br = 0;
+    if (f_lseek(fil, inOffset) != FR_OK || f_read(fil, header, sizeof(header), &br) != FR_OK || br == 0) {
+        return false;
+    }
+    uint8_t c = header[0];
+    uint64_t num = (c >> 2) & 0x1F;
+    uint bits = 5;
+    uint i = 1;
+    while (c & 0x80) {
+        if (i >= br) {
+            return false;
+        }
+        c = header[i++];
+        num |= uint64_t(c & 0x7F) << bits;
+        bits += 7;
+    }
+    if (uint32_t(num) == 0xFFFFFFFF) {
+        return false;  // End of stream
+    }
+
+    record->type = header[0] & 3;
+    record->count = uint32_t(num) + 1;
+    record->dataOffset = inOffset + i;
+    record->outOffset = outOffset;
+    const uint64_t nextOffset = uint64_t(record->dataOffset) + uint64_t(record->count) * c_inUnit[record->type];
+    const uint64_t outEnd = uint64_t(outOffset) + uint64_t(record->count) * c_outUnit[record->type];
+    if (nextOffset > 0xFFFFFFFF || outEnd > 0xFFFFFFFF) {
+        return false;
+    }
+    record->nextOffset = nextOffset;
+    return true;
+}
+
+// Walks the record headers, reading only the headers. Without a table it just counts the records, with one it
+// keeps every stride-th record as a checkpoint.
+static uint32_t walkRecords(EcmFile *ecm) {
+    uint32_t inOffset = 4;  // After the magic
+    uint32_t outOffset = 0;
+    uint32_t recordIndex = 0;
+    Record record;
+    while (readRecord(ecm->fil, inOffset, outOffset, &record)) {
+        if (ecm->checkpoints && recordIndex % ecm->stride == 0) {
+            ecm->checkpoints[ecm->count++] = {inOffset, outOffset};
+        }
+        recordIndex++;
+        inOffset = record.nextOffset;
+        outOffset = record.outEnd();
+    }
+    ecm->decodedSize = outOffset;
+    return recordIndex;
+}
+
+// Two header passes: the record count sizes the table, so short files only take what they need
+static bool buildIndex(EcmFile *ecm) {
+    uint8_t magic[4];
+    if (!readAt(ecm->fil, 0, magic, sizeof(magic)) || memcmp(magic, "ECM\0", sizeof(magic)) != 0) {
+        return false;
+    }
+
+    const uint32_t records = walkRecords(ecm);
+    if (records == 0) {
+        return false;
+    }
+    ecm->stride = (records + c_maxCheckpoints - 1) / c_maxCheckpoints;
+    ecm->checkpoints = (Checkpoint *)malloc(((records + ecm->stride - 1) / ecm->stride) * sizeof(Checkpoint));
+    if (!ecm->checkpoints) {
+        return false;
+    }
+    ecm->count = 0;
+    walkRecords(ecm);
+    DEBUG_PRINT("ecm: %lu records, %lu checkpoints, %lu bytes decoded\n", records, ecm->count, ecm->decodedSize);
+    return true;
+}
+
+static bool loadIndex(EcmFile *ecm, const TCHAR *indexPath) {
+    FIL file;
+    if (f_open(&file, indexPath, FA_READ) != FR_OK) {
+        return false;
+    }
+    IndexHeader header;
+    UINT br = 0;
+    bool ok = f_read(&file, &header, sizeof(header), &br) == FR_OK && br == sizeof(header) &&
+              header.magic == c_indexMagic && header.version == c_indexVersion &&
+              header.ecmSize == f_size(ecm->fil) && header.count > 0 && header.count <= c_maxCheckpoints;
+    if (ok) {
+        const UINT length = header.count * sizeof(Checkpoint);
+        ecm->checkpoints = (Checkpoint *)malloc(length);
+        ok = ecm->checkpoints && f_read(&file, ecm->checkpoints, length, &br) == FR_OK && br == length;
+    }
+    f_close(&file);
+    if (ok) {
+        ecm->decodedSize = header.decodedSize;
+        ecm->stride = header.stride;
+        ecm->count = header.count;
+    } else {
+        free(ecm->checkpoints);
+        ecm->checkpoints = nullptr;
+    }
+    return ok;
+}
+
+static void saveIndex(const EcmFile *ecm, const TCHAR *indexPath) {
+    FIL file;
+    FRESULT fr = f_open(&file, indexPath, FA_WRITE | FA_CREATE_ALWAYS);
+    if (fr != FR_OK) {
+        DEBUG_PRINT("ecm: f_open(%s) error: %s (%d)\n", indexPath, FRESULT_str(fr), fr);
+        return;
+    }
+    const IndexHeader header = {c_indexMagic, c_indexVersion, (uint32_t)f_size(ecm->fil), ecm->decodedSize,
+                                ecm->stride, ecm->count};
+    UINT bw;
+    f_write(&file, &header, sizeof(header), &bw);
+    f_write(&file, ecm->checkpoints, ecm->count * sizeof(Checkpoint), &bw);
+    f_close(&file);
+}
+
+static EcmFile *find(const CueFile *file) {
+    for (EcmFile *ecm = s_files; ecm; ecm = ecm->next) {
+        if (ecm->file == file) {
+            return ecm;
+        }
+    }
+    return nullptr;
+}
+
+static void ecmSize(CueFile *file, CueScheduler *scheduler, int, void (*cb)(CueFile *, CueScheduler *, uint64_t)) {
+    File_schedule_size(file, scheduler, find(file)->decodedSize, cb);
+}
+
+// Finds the record holding offset: from the last one used when reading on, else from the nearest checkpoint
+static bool locate(EcmFile *ecm, uint32_t offset) {
+    if (ecm->currentValid && offset >= ecm->current.outOffset && offset < ecm->current.outEnd()) {
+        return true;
+    }
+
+    uint low = 0;
+    uint high = ecm->count;
+    while (high - low > 1) {
+        const uint middle = (low + high) / 2;
+        if (ecm->checkpoints[middle].outOffset <= offset) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    const Checkpoint &checkpoint = ecm->checkpoints[low];
+
+    Record record = ecm->current;
+    if (!ecm->currentValid || record.outOffset < checkpoint.outOffset || record.outOffset > offset) {
+        if (!readRecord(ecm->fil, checkpoint.inOffset, checkpoint.outOffset, &record)) {
+            ecm->currentValid = false;
+            return false;
+        }
+    }
+    while (offset >= record.outEnd()) {
+        if (!readRecord(ecm->fil, record.nextOffset, record.outEnd(), &record)) {
+            ecm->currentValid = false;
+            return false;
+        }
+    }
+    ecm->current = record;
+    ecm->currentValid = true;
+    return true;
+}
+
+// Rebuilds one sector in the raw 2352-byte layout, returns where its output bytes start
+static const uint8_t *decodeUnit(EcmFile *ecm, const Record &record, uint32_t unit, uint8_t *sector) {
+    const uint32_t inOffset = record.dataOffset + unit * c_inUnit[record.type];
+    switch (record.type) {
+        case RecordType::MODE1:
+            if (!readAt(ecm->fil, inOffset, sector + 12, 3) || !readAt(ecm->fil, inOffset + 3, sector + 16, 2048)) {
+                return nullptr;
+            }
+            picostation::edcecc::writeSync(sector);
+            sector[15] = 1;
+            picostation::edcecc::encodeMode1(sector);
+            return sector;
+
+        case RecordType::MODE2_FORM1:
+            if (!readAt(ecm->fil, inOffset, sector + 0x10, 4) || !readAt(ecm->fil, inOffset + 4, sector + 0x18, 2048)) {
+                return nullptr;
+            }
+            memcpy(sector + 0x14, sector + 0x10, 4);
+            picostation::edcecc::encodeMode2Form1(sector);
+            return sector + 0x10;
+
+        case RecordType::MODE2_FORM2:
+        default:
+            if (!readAt(ecm->fil, inOffset, sector + 0x10, 4) || !readAt(ecm->fil, inOffset + 4, sector + 0x18, 2324)) {
+                return nullptr;
+            }
+            memcpy(sector + 0x14, sector + 0x10, 4);
+            picostation::edcecc::encodeMode2Form2(sector);
+            return sector + 0x10;
+    }
+}
+
+bool picostation::ecm::attach(CueFile *file, const TCHAR *path) {
+    if (!s_sector) {
+        s_sector = (uint8_t *)malloc(2352);
+    }
+    EcmFile *ecm = (EcmFile *)calloc(1, sizeof(EcmFile));
+    if (!ecm || !s_sector) {
+        DEBUG_PRINT("ecm: out of memory for %s\n", path);
+        free(ecm);
+        return false;
+    }
+    ecm->file = file;
+    ecm->fil = (FIL *)file->opaque;
+
+    TCHAR indexPath[260];
+    snprintf(indexPath, sizeof(indexPath), "%s.idx", path);
+    if (!loadIndex(ecm, indexPath)) {
+        DEBUG_PRINT("ecm: indexing %s\n", path);
+        if (!buildIndex(ecm)) {
+            free(ecm->checkpoints);
+            free(ecm);
+            return false;
+        }
+        saveIndex(ecm, indexPath);
+    }
+
+    file->size = ecmSize;
+    ecm->next = s_files;
+    s_files = ecm;
+    return true;
+}
+
+bool picostation::ecm::isAttached(const CueFile *file) { return find(file) != nullptr; }
+
+FRESULT picostation::ecm::read(const CueFile *file, uint64_t offset, void *buffer, UINT length, UINT *bytesRead) {
+    EcmFile *ecm = find(file);
+    uint8_t *destination = (uint8_t *)buffer;
+    *bytesRead = 0;
+
+    while (length > 0 && offset < ecm->decodedSize) {
+        if (!locate(ecm, offset)) {
+            return FR_INT_ERR;
+        }
+        const Record &record = ecm->current;
+        const uint32_t position = offset - record.outOffset;
+        UINT chunk;
+
+        if (record.type == RecordType::RAW) {
+            chunk = MIN(length, record.outEnd() - offset);
+            UINT br = 0;
+            FRESULT fr = f_lseek(ecm->fil, record.dataOffset + position);
+            if (fr == FR_OK) {
+                fr = f_read(ecm->fil, destination, chunk, &br);
+            }
+            *bytesRead += br;
+            if (fr != FR_OK || br != chunk) {
+                return fr;
+            }
+        } else {
+            const uint32_t outUnit = c_outUnit[record.type];
+            const uint32_t within = position % outUnit;
+            chunk = MIN(length, outUnit - within);
+            // Whole mode 1 sectors are rebuilt in place, everything else goes through s_sector
+            if (record.type == RecordType::MODE1 && within == 0 && chunk == outUnit) {
+                if (!decodeUnit(ecm, record, position / outUnit, destination)) {
+                    return FR_INT_ERR;
+                }
+            } else {
+                const uint8_t *decoded = decodeUnit(ecm, record, position / outUnit, s_sector);
+                if (!decoded) {
+                    return FR_INT_ERR;
+                }
+                memcpy(destination, decoded + within, chunk);
+            }
+            *bytesRead += chunk;
+        }
+
+        offset += chunk;
+        destination += chunk;
+        length -= chunk;
+    }
+    return FR_OK;
+}
+
+void picostation::ecm::reset() {
+    while (s_files) {
+        EcmFile *next = s_files->next;
+        free(s_files->checkpoints);
+        free(s_files);
+        s_files = next;
+    }
+    free(s_sector);
+    s_sector = nullptr;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "../third_party/cueparser/fileabstract.h"
+#include "ff.h"
+
+namespace picostation {
+namespace ecm {
+// Serves an ECM-encoded image file (as produced by the ecm tool) as the raw file it was made from. The record
+// headers are indexed once and the index is kept next to the image in "<path>.idx", so random reads only walk
+// a bounded number of headers; EDC/ECC are regenerated per sector on read.
+bool attach(struct CueFile *file, const TCHAR *path);
+bool isAttached(const struct CueFile *file);
+FRESULT read(const struct CueFile *file, uint64_t offset, void *buffer, UINT length, UINT *bytesRead);
+void reset();  // Forget all attached files, call before loading another image
+}  // namespace ecm
+}  // namespace picostation
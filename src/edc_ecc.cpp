@@ -0,0 +1,158 @@
+#include "edc_ecc.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include <array>
+
+// ECMA-130 annex A/B. Tables are built at compile time, one lookup per byte keeps a sector well under 2x pace.
+
+static constexpr size_t c_edcOffset = 0x810;
+static constexpr size_t c_eccPOffset = 0x81C;
+static constexpr size_t c_eccQOffset = 0x8C8;
+static constexpr size_t c_form1EdcOffset = 0x818;
+static constexpr size_t c_form2EdcOffset = 0x92C;
+
+static constexpr std::array<uint32_t, 256> c_edcLut = [] {
+    std::array<uint32_t, 256> lut{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t edc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            edc = (edc >> 1) ^ ((edc & 1) ? 0xD8018001 : 0);
+        }
+        lut[i] = edc;
+    }
+    return lut;
+}();
+
+// GF(2^8) with x^8 + x^4 + x^3 + x^2 + 1: multiply by alpha, and divide by (alpha + 1)
+static constexpr std::array<uint8_t, 256> c_eccFLut = [] {
+    std::array<uint8_t, 256> lut{};
+    for (uint32_t i = 0; i < 256; i++) {
+        lut[i] = (i << 1) ^ ((i & 0x80) ? 0x11D : 0);
+    }
+    return lut;
+}();
+
+static constexpr std::array<uint8_t, 256> c_eccBLut = [] {
+    std::array<uint8_t, 256> lut{};
+    for (uint32_t i = 0; i < 256; i++) {
+        lut[i ^ c_eccFLut[i]] = i;
+    }
+    return lut;
+}();
+
+static inline uint8_t toBCD(const int in) { return (in / 10) << 4 | (in % 10); }
+
+static uint32_t computeEDC(const uint8_t *data, size_t length) {
+    uint32_t edc = 0;
+    for (size_t i = 0; i < length; i++) {
+        edc = (edc >> 8) ^ c_edcLut[(edc ^ data[i]) & 0xFF];
+    }
+    return edc;
+}
+
+// One RSPC pass (P or Q) over the header + data area starting at offset 12
+static void computeECC(const uint8_t *src, uint32_t majorCount, uint32_t minorCount, uint32_t majorMult,
+                       uint32_t minorInc, uint8_t *dest) {
+    const uint32_t size = majorCount * minorCount;
+    for (uint32_t major = 0; major < majorCount; major++) {
+        uint32_t index = (major >> 1) * majorMult + (major & 1);
+        uint8_t eccA = 0;
+        uint8_t eccB = 0;
+        for (uint32_t minor = 0; minor < minorCount; minor++) {
+            const uint8_t value = src[index];
+            index += minorInc;
+            if (index >= size) {
+                index -= size;
+            }
+            eccA ^= value;
+            eccB ^= value;
+            eccA = c_eccFLut[eccA];
+        }
+        eccA = c_eccBLut[c_eccFLut[eccA] ^ eccB];
+        dest[major] = eccA;
+        dest[major + majorCount] = eccA ^ eccB;
+    }
+}
+
+static void writeEDC(uint8_t *dest, const uint32_t edc) {
+    dest[0] = edc;
+    dest[1] = edc >> 8;
+    dest[2] = edc >> 16;
+    dest[3] = edc >> 24;
+}
+
+static void writeECC(uint8_t *sector) {
+    computeECC(sector + 12, 86, 24, 2, 86, sector + c_eccPOffset);
+    computeECC(sector + 12, 52, 43, 86, 88, sector + c_eccQOffset);
+}
+
+static void writeHeader(uint8_t *sector, const int lba, const uint8_t mode) {
+    picostation::edcecc::writeSync(sector);
+
+    int absolute = lba + 150;
+    if (absolute < 0) {
+        absolute += 100 * 60 * 75;  // Lead-in addresses count up to 99:59:74
+    }
+    sector[12] = toBCD(absolute / 75 / 60);
+    sector[13] = toBCD((absolute / 75) % 60);
+    sector[14] = toBCD(absolute % 75);
+    sector[15] = mode;
+}
+
+void picostation::edcecc::buildMode1(uint8_t *sector, const int lba) {
+    writeHeader(sector, lba, 1);
+    encodeMode1(sector);
+}
+
+void picostation::edcecc::buildMode2(uint8_t *sector, const int lba) { writeHeader(sector, lba, 2); }
+
+void picostation::edcecc::writeSync(uint8_t *sector) {
+    sector[0] = 0x00;
+    for (int i = 1; i < 11; i++) {
+        sector[i] = 0xFF;
+    }
+    sector[11] = 0x00;
+}
+
+void picostation::edcecc::encodeMode1(uint8_t *sector) {
+    writeEDC(sector + c_edcOffset, computeEDC(sector, c_edcOffset));
+    for (size_t i = c_edcOffset + 4; i < c_eccPOffset; i++) {
+        sector[i] = 0;
+    }
+    writeECC(sector);
+}
+
+// The header is not covered by mode 2 form 1 ECC, it is computed as if the address and mode were zero
+void picostation::edcecc::encodeMode2Form1(uint8_t *sector) {
+    writeEDC(sector + c_form1EdcOffset, computeEDC(sector + 0x10, c_form1EdcOffset - 0x10));
+    uint8_t header[4];
+    memcpy(header, sector + 12, sizeof(header));
+    memset(sector + 12, 0, sizeof(header));
+    writeECC(sector);
+    memcpy(sector + 12, header, sizeof(header));
+}
+
+void picostation::edcecc::encodeMode2Form2(uint8_t *sector) {
+    writeEDC(sector + c_form2EdcOffset, computeEDC(sector + 0x10, c_form2EdcOffset - 0x10));
+}
+
+static uint32_t readEDC(const uint8_t *src) {
+    return src[0] | (src[1] << 8) | (src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+bool picostation::edcecc::checkEDC(const uint8_t *sector) {
+    switch (sector[15]) {
+        case 1:
+            return readEDC(sector + c_edcOffset) == computeEDC(sector, c_edcOffset);
+        case 2:
+            if (sector[18] & 0x20) {  // Submode form 2
+                const uint32_t edc = readEDC(sector + c_form2EdcOffset);
+                return edc == 0 || edc == computeEDC(sector + 0x10, c_form2EdcOffset - 0x10);
+            }
+            return readEDC(sector + c_form1EdcOffset) == computeEDC(sector + 0x10, c_form1EdcOffset - 0x10);
+        default:
+            return true;
+    }
+}
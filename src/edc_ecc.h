@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace picostation {
+namespace edcecc {
+// Rebuilds the parts of a raw 2352-byte data sector that cooked images leave out. The user data must already be
+// at offset 16 (2048 bytes for mode 1, 2336 bytes of subheader + data + EDC/ECC for mode 2). lba is the
+// disc-relative sector, the header carries its absolute MSF (lba + 150, wrapped to 99:xx:xx in the lead-in).
+void buildMode1(uint8_t *sector, const int lba);
+void buildMode2(uint8_t *sector, const int lba);
+
+// Lower level encoders for sectors whose sync, header and subheader are already in place
+void writeSync(uint8_t *sector);
+void encodeMode1(uint8_t *sector);
+void encodeMode2Form1(uint8_t *sector);
+void encodeMode2Form2(uint8_t *sector);
+
+// False when a raw data sector's stored EDC doesn't match its contents. Form 2 sectors may leave the EDC zero and
+// sectors of other modes have none, those always pass.
+bool checkEDC(const uint8_t *sector);
+}  // namespace edcecc
+}  // namespace picostation
@@ -34,6 +34,8 @@ socket, which SPI it is driven by, and how it is wired.
 #include "ff.h" /* Obtains integer types */
 //
 #include "diskio.h" /* Declarations of disk functions */
+//
+#include "sdio.h"
 
 void spi1_dma_isr();
 
@@ -58,6 +60,22 @@ static sd_card_t sd_cards[] = {  // One for each SD card
                                         // present. Use -1 if there is no card detect.
      .m_Status = STA_NOINIT}};
 
+// Optional 4-bit SD bus (PICOSTATION_SDIO). The reference board wires the card for SPI only and cannot run
+// 4-bit mode, so there are no default pins. A board that routes CLK, CMD and DAT0-DAT3 (consecutive GPIOs) to
+// the card sets them from CMake. Falls back to spis[] above if the card does not answer on it.
+#if PICOSTATION_SDIO
+#if !defined(PICOSTATION_SDIO_CLK_GPIO) || !defined(PICOSTATION_SDIO_CMD_GPIO) || !defined(PICOSTATION_SDIO_D0_GPIO)
+#error "PICOSTATION_SDIO needs PICOSTATION_SDIO_CLK_GPIO, PICOSTATION_SDIO_CMD_GPIO and PICOSTATION_SDIO_D0_GPIO"
+#endif
+
+static const picostation::sdio::Config sdio_config = {
+    .pio = pio1,
+    .clkGpio = PICOSTATION_SDIO_CLK_GPIO,
+    .cmdGpio = PICOSTATION_SDIO_CMD_GPIO,
+    .d0Gpio = PICOSTATION_SDIO_D0_GPIO,
+    .baudRate = 25 * 1000 * 1000};
+#endif
+
 /* ********************************************************************** */
 size_t sd_get_num() { return count_of(sd_cards); }
 sd_card_t *sd_get_by_num(size_t num) {
@@ -76,4 +94,8 @@ spi_t *spi_get_by_num(size_t num) {
     }
 }
 
+#if PICOSTATION_SDIO
+const picostation::sdio::Config *picostation::sdio::getConfig() { return &sdio_config; }
+#endif
+
 /* [] END OF FILE */
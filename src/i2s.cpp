@@ -9,16 +9,29 @@
 
 #include "cmd.h"
 #include "disc_image.h"
+#include "diskio.h"
 #include "f_util.h"
 #include "ff.h"
 #include "hardware/dma.h"
+#include "hardware/structs/busctrl.h"
 #include "hardware/pio.h"
 #include "hw_config.h"
+#include "image_config.h"
+#include "image_verify.h"
 #include "logging.h"
 #include "main.pio.h"
+#include "mem_stats.h"
 #include "pico/stdlib.h"
 #include "picostation.h"
+#include "pinned_sectors.h"
+#include "playlist.h"
 #include "rtc.h"
+#include "sample_copy.h"
+#include "sd_clock.h"
+#include "sdio.h"
+#include "sector_cache.h"
+#include "sector_trace.h"
+#include "seek_model.h"
 #include "subq.h"
 #include "utils.h"
 #include "values.h"
@@ -29,12 +42,98 @@
 #define DEBUG_PRINT(...) while (0)
 #endif
 
+// A cue sheet or an .m3u playlist, an .m3u of the same name next to the cue sheet is used instead
 const TCHAR target_Cues[NUM_IMAGES][11] = {
     "UNIROM.cue",
 };
-const int g_imageIndex = 0;  // To-do: Implement a console side menu to select the cue file
+static picostation::Playlist s_playlist;  // To-do: Implement a console side menu to select the cue file
+static int s_discIndex = 0;               // Opening the lid moves to the next disc of the playlist
 
 static uint64_t s_psneeTimer;
+static uint32_t s_remounts = 0;
+
+// Core1's working set is static, its stack is the 2 KB one in scratch_x. Main SRAM is word-striped over four
+// banks, so the I2S DMA reads, the SD driver's DMA writes and the copy loop below rarely land on the same bank.
+static uint32_t s_pioSamples[2][(c_cdSamplesBytes * 2) / sizeof(uint32_t)];
+static uint16_t s_scramblingKey[1176];
+static picostation::SectorCache s_sectorCache(&picostation::g_discImage);
+static picostation::PinnedSectors s_pinnedSectors;
+static picostation::ImageConfig s_imageConfig;
+static picostation::ImageVerifier s_imageVerifier;
+
+#if DEBUG_I2S
+// Contested accesses per bus arbiter, printed every c_busStatsIntervalUs
+static constexpr uint64_t c_busStatsIntervalUs = 5000000;
+static constexpr bus_ctrl_perf_counter_t c_busEvents[4] = {
+    arbiter_sram0_perf_event_access_contested,  // One of the four striped banks
+    arbiter_sram4_perf_event_access_contested,  // scratch_x
+    arbiter_sram5_perf_event_access_contested,  // scratch_y
+    arbiter_xip_main_perf_event_access_contested,
+};
+static uint64_t s_busStatsTimer;
+
+// Per playback speed: how much of the playing sector was left when the next one was ready, and how many were not
+// ready when the DMA finished, so the previous samples went out again
+struct PipelineStats {
+    uint32_t sectors;
+    uint32_t late;
+    int32_t minSlackUs;
+};
+static PipelineStats s_pipelineStats[2];
+static picostation::seekmodel::Stats s_lastSeeks = {0, 0};
+
+static void resetBusStats() {
+    for (int i = 0; i < 4; i++) {
+        busctrl_hw->counter[i].sel = c_busEvents[i];
+        busctrl_hw->counter[i].value = 0;  // Any write clears
+    }
+    for (PipelineStats &stats : s_pipelineStats) {
+        stats = {0, 0, INT32_MAX};
+    }
+    s_busStatsTimer = time_us_64();
+}
+
+static void recordSlack(const int speed, const bool ready, const int32_t slackUs) {
+    PipelineStats &stats = s_pipelineStats[speed - 1];
+    stats.sectors++;
+    if (!ready) {
+        stats.late++;
+    } else {
+        stats.minSlackUs = std::min(stats.minSlackUs, slackUs);
+    }
+}
+
+static void printBusStats() {
+    if ((time_us_64() - s_busStatsTimer) < c_busStatsIntervalUs) {
+        return;
+    }
+    DEBUG_PRINT("bus contested: sram0 %u, scratch_x %u, scratch_y %u, xip %u\n", (unsigned)busctrl_hw->counter[0].value,
+                (unsigned)busctrl_hw->counter[1].value, (unsigned)busctrl_hw->counter[2].value,
+                (unsigned)busctrl_hw->counter[3].value);
+    const picostation::DiscImage::ReadStats reads = picostation::g_discImage.getReadStats();
+    DEBUG_PRINT("sd: %u reads, %u retries, %u failed, %u remounts\n", (unsigned)reads.reads, (unsigned)reads.retries,
+                (unsigned)reads.failures, (unsigned)s_remounts);
+    const picostation::SectorCache::Stats cache = s_sectorCache.getStats();
+    DEBUG_PRINT("cache: %u hits, %u misses (%u missed again), %u streamed\n", (unsigned)cache.hits,
+                (unsigned)cache.misses, (unsigned)cache.remisses, (unsigned)cache.streamed);
+    const picostation::sdclock::Stats clock = picostation::sdclock::getStats(sd_get_by_num(0));
+    DEBUG_PRINT("sd clock: %u Hz, %u crc errors, %u fallbacks\n", clock.baudRate, (unsigned)clock.crcErrors,
+                (unsigned)clock.clockFallbacks);  // 0 Hz on the 4-bit bus
+    // core0 counts the jumps, so the interval is the difference rather than a reset from here
+    const picostation::seekmodel::Stats seeks = picostation::seekmodel::getStats();
+    DEBUG_PRINT("seek profile %u: %u jumps, %u us emulated\n", picostation::seekmodel::getProfile(),
+                (unsigned)(seeks.jumps - s_lastSeeks.jumps), (unsigned)(seeks.totalDelayUs - s_lastSeeks.totalDelayUs));
+    s_lastSeeks = seeks;
+    for (int i = 0; i < 2; i++) {
+        const PipelineStats &stats = s_pipelineStats[i];
+        if (stats.sectors > 0) {
+            DEBUG_PRINT("x%d: %u sectors, %u late, min slack %d us\n", i + 1, (unsigned)stats.sectors,
+                        (unsigned)stats.late, stats.minSlackUs == INT32_MAX ? -1 : (int)stats.minSlackUs);
+        }
+    }
+    resetBusStats();
+}
+#endif
 
 inline void picostation::I2S::generateScramblingKey(uint16_t *cdScramblingKey) {
     int key = 1;
@@ -59,12 +158,30 @@ inline void picostation::I2S::generateScramblingKey(uint16_t *cdScramblingKey) {
     }
 }
 
-void picostation::I2S::mountSDCard() {
+// Shared by boot and remount, so a card that comes back gets the same bus and clock as at power on
+FRESULT picostation::I2S::mountSDCard() {
     sd_card_t *pSD = sd_get_by_num(0);
-    FRESULT fr = f_mount(&pSD->fatfs, pSD->pcName, 1);
-    if (FR_OK != fr) {
-        panic("f_mount error: %s (%d)\n", FRESULT_str(fr), fr);
+#if PICOSTATION_SDIO
+    sd_init_driver();
+    sdio::attach(pSD, sdio::getConfig());
+#endif
+    const FRESULT fr = f_mount(&pSD->fatfs, pSD->pcName, 1);
+    if (FR_OK == fr) {
+        sdclock::tune(pSD);
     }
+    return fr;
+}
+
+// For a card that stopped answering. Files opened on the old mount are invalid afterwards, the image has to be
+// loaded again.
+bool picostation::I2S::remountSDCard() {
+    sd_card_t *pSD = sd_get_by_num(0);
+    sd_read_stream_stop(pSD);  // An open CMD18 keeps chip select asserted, end it before the card is reset
+    f_unmount(pSD->pcName);
+    pSD->m_Status |= STA_NOINIT;  // So f_mount initialises the card again
+    const FRESULT fr = mountSDCard();
+    DEBUG_PRINT("Remount: %s (%d)\n", FRESULT_str(fr), fr);
+    return FR_OK == fr;
 }
 
 inline int picostation::I2S::initDMA(const volatile void *read_addr, uint transfer_count) {
@@ -81,29 +198,50 @@ inline int picostation::I2S::initDMA(const volatile void *read_addr, uint transf
 }
 
 [[noreturn]] void __time_critical_func(picostation::I2S::start)() {
-    static constexpr int c_sectorCacheSize = 50;
+    static constexpr int64_t c_sectorUs = 13333;      // Playing time at 1x
+    static constexpr int64_t c_swapMarginUs = 200;    // Kept clear ahead of the DMA finishing
+    static constexpr int64_t c_minReadCostUs = 1500;  // One sector over SPI at the slowest tuned clock
+    // The lid switch's polarity is a build option, it has not been checked on a console yet
+    static constexpr bool c_doorOpenLevel = PICOSTATION_DOOR_OPEN_HIGH;
+    static constexpr uint64_t c_doorDebounceUs = 50000;
+    static constexpr uint64_t c_remountIntervalUs = 2000000;  // Between attempts while the card stays away
+    static constexpr uint64_t c_spindleIdleUs = 1000000;      // Longer than any seek or speed change leaves GFS low
 
     // TODO: separate PSNEE, cue parse, and i2s functions
-    uint32_t pioSamples[2][(c_cdSamplesBytes * 2) / sizeof(uint32_t)] = {0};
     int bufferForDMA = 1;
     int bufferForSDRead = 0;
     int loadedSector[2];
 
-    int cachedSectors[c_sectorCacheSize];
-    int roundRobinCacheIndex = 0;
-    uint16_t cdSamples[c_sectorCacheSize][c_cdSamplesBytes / sizeof(uint16_t)];
-
-    uint16_t cdScramblingKey[1176];
+    int prefetchSector = -1;
+    int prefetchRemaining = 0;
+    uint64_t dmaStartTime = 0;
+    int64_t readCostUs = 3000;  // Recent worst prefetch read, optional work only starts if this much is left
+#if DEBUG_I2S
+    int32_t readySlackUs = 0;  // Time left on the playing sector when the next one was ready
+#endif
+    // Held here and published with one store, so a reset from core0 can't be overwritten by an older peak
+    int32_t heldPeak = 0;
+    uint32_t peakResets = g_audioPeakResets;
 
     auto currentSector = -1;
     g_sectorSending = -1;
+    g_prefetchSector = -1;
     int loadedImageIndex = -1;
+    uint64_t remountTime = 0;
+    const ImageConfig::Settings &config = s_imageConfig.settings();
+    bool doorOpen = gpio_get(Pin::DOOR) == c_doorOpenLevel;  // Booting with the lid open keeps the first disc
+    uint64_t doorChangeTime = 0;   // When DOOR first differed from doorOpen, 0 while it agrees
+    uint64_t spindleStopTime = 0;  // When GFS went low, 0 while the spindle is locked
 
-    generateScramblingKey(cdScramblingKey);
+    generateScramblingKey(s_scramblingKey);
 
-    mountSDCard();
+    const FRESULT fr = mountSDCard();
+    if (FR_OK != fr) {
+        panic("f_mount error: %s (%d)\n", FRESULT_str(fr), fr);
+    }
+    s_playlist.load(target_Cues[0]);
 
-    int dmaChannel = initDMA(pioSamples[0], c_cdSamplesSize * 2);
+    int dmaChannel = initDMA(s_pioSamples[0], c_cdSamplesSize * 2);
 
     g_coreReady[1] = true;   // Core 1 is ready
     while (!g_coreReady[0])  // Wait for Core 0 to be ready
@@ -112,32 +250,112 @@ inline int picostation::I2S::initDMA(const volatile void *read_addr, uint transf
     }
 
     s_psneeTimer = time_us_64();
+#if DEBUG_I2S
+    resetBusStats();
+#endif
 
     while (true) {
-        // Update latching, output SENS
-        if (mutex_try_enter(&g_mechaconMutex, 0)) {
-            mechcommand::updateMechSens();
-            mutex_exit(&g_mechaconMutex);
-        }
+        // At 2x each sector has half the time, the deadline is when the DMA reaches the end of the playing buffer
+        const int speed = g_playbackSpeed.Load();
+        const int64_t sectorUs = c_sectorUs / speed;
+        g_discImage.setReadDeadline(dmaStartTime + sectorUs);  // Read retries must not hold up the buffer swap
 
         // Sector could change during the loop, so we need to keep track of it
         currentSector = g_sector.Load();
 
-        psnee(currentSector);
+        const uint32_t resets = g_audioPeakResets;  // A NORMAL audio control mode clears the held peak
+        if (resets != peakResets) {
+            peakResets = resets;
+            heldPeak = 0;
+            g_audioPeak = 0;
+        }
+
+        if (speed == 1 && config.psnee) {
+            psnee(currentSector);
+        }
+
+        // The next disc is loaded as soon as the lid opens, while the console waits for it to close again
+        if ((gpio_get(Pin::DOOR) == c_doorOpenLevel) == doorOpen) {
+            doorChangeTime = 0;
+        } else if (doorChangeTime == 0) {
+            doorChangeTime = time_us_64();
+        } else if ((time_us_64() - doorChangeTime) >= c_doorDebounceUs) {
+            doorOpen = !doorOpen;
+            doorChangeTime = 0;
+            DEBUG_PRINT("Lid %s\n", doorOpen ? "open" : "closed");
+            if (doorOpen) {
+                s_discIndex = s_playlist.next(s_discIndex);
+            }
+        }
 
-        if (loadedImageIndex != g_imageIndex) {
-            g_discImage.load(target_Cues[g_imageIndex]);
-            loadedImageIndex = g_imageIndex;
+        // The .pin file is only rewritten once the spindle has stopped: nothing is read then, and the console has
+        // to wait for it to spin up again before the next sector anyway
+        if (mechcommand::getSens(SENS::GFS)) {
+            spindleStopTime = 0;
+        } else if (spindleStopTime == 0) {
+            spindleStopTime = time_us_64();
+        } else if ((time_us_64() - spindleStopTime) >= c_spindleIdleUs) {
+            s_pinnedSectors.maybeSave();
+        }
+
+        // Reads keep failing: the card may have dropped out. A stall while it is mounted again beats a crash.
+        if (g_discImage.needsRemount() && (time_us_64() - remountTime) >= c_remountIntervalUs) {
+            remountTime = time_us_64();
+            s_remounts++;
+            if (remountSDCard()) {
+                loadedImageIndex = -1;
+            }
+        }
+
+        if (loadedImageIndex != s_discIndex) {
+            const uint64_t loadStart = time_us_64();
+            g_discImage.setReadDeadline(0);  // Nothing is playing from the new image yet
+            s_pinnedSectors.save();  // What was learned on the previous disc
+            // The console sees no SubQ until the new layout is complete, as with the lid open
+            g_discLoading = true;
+            while (g_subqBusy.Load()) {
+                tight_loop_contents();
+            }
+            g_discImage.load(s_playlist.path(s_discIndex));
+            g_discLoading = false;
+            s_imageConfig.load(s_playlist.path(s_discIndex));
+            seekmodel::setProfile(config.seekProfile);
+            loadedImageIndex = s_discIndex;
+#if DEBUG_MEM
+            memstats::report();  // The cue parser and FatFs have done their allocations by now
+#endif
 
             // Reset cache and loaded sectors
             loadedSector[0] = -1;
             loadedSector[1] = -1;
-            roundRobinCacheIndex = 0;
             bufferForDMA = 1;
             bufferForSDRead = 0;
-            memset(cachedSectors, -1, sizeof(cachedSectors));
-            memset(cdSamples, 0, sizeof(cdSamples));
-            memset(pioSamples, 0, sizeof(pioSamples));
+            prefetchRemaining = 0;
+            s_sectorCache.selectDisc(s_discIndex);
+            s_sectorCache.configure(config.cacheSlots, config.streamRun);
+            memset(s_pioSamples, 0, sizeof(s_pioSamples));
+            s_pinnedSectors.load(s_playlist.path(s_discIndex), &g_discImage);
+            for (int i = 0; i < s_pinnedSectors.count(); i++) {
+                s_sectorCache.pin(s_pinnedSectors.lba(i) + c_leadIn + c_preGap);
+            }
+#if PICOSTATION_SECTOR_TRACE
+            sectortrace::open(s_playlist.path(s_discIndex));
+#endif
+            if (config.verify) {
+                s_imageVerifier.start(s_playlist.path(s_discIndex), &g_discImage);
+            } else {
+                s_imageVerifier.stop();
+            }
+            DEBUG_PRINT("Disc %d/%d %s ready in %u ms\n", s_discIndex + 1, s_playlist.count(),
+                        s_playlist.path(s_discIndex), (unsigned)((time_us_64() - loadStart) / 1000));
+        }
+
+        // A seek was just issued, its destination is known before the seek delay expires
+        const int seekTarget = g_prefetchSector.Load();
+        if (seekTarget >= 0) {
+            g_prefetchSector = -1;  // A target posted in between is lost, that sector is then read on demand
+            prefetchSector = seekTarget;
+            prefetchRemaining = config.prefetchDepth[speed - 1];  // Deeper at 2x, the console gets there sooner
         }
 
         if (bufferForDMA != bufferForSDRead) {
@@ -149,54 +367,91 @@ inline int picostation::I2S::initDMA(const volatile void *read_addr, uint transf
                 }
             }
 
-            // Sector cache lookup/update
-            int cache_hit = -1;
-            // Need to take a different path if sector is in the lead-in/pregap
-            for (int i = 0; i < c_sectorCacheSize; i++) {
-                if (cachedSectors[i] == currentSector) {
-                    cache_hit = i;
-                    break;
+            // Sectors outside the image files are generated and kept out of the cache
+            bool isData;
+            const uint16_t *sectorData = g_discImage.syntheticSector(currentSector, &isData);
+            if (!sectorData) {
+                const picostation::SectorCache::Stats before = s_sectorCache.getStats();
+                sectorData = s_sectorCache.get(currentSector);
+                isData = g_discImage.isCurrentTrackData();
+                // Only sectors the cache could not keep: a pause loop or a held sector replays what it already has,
+                // and files read once never come back
+                if (s_sectorCache.getStats().remisses != before.remisses && !s_sectorCache.isStreaming()) {
+                    s_pinnedSectors.record(currentSector - c_leadIn - c_preGap);
                 }
+#if PICOSTATION_SECTOR_TRACE
+                const bool miss = s_sectorCache.getStats().misses != before.misses;
+                sectortrace::record(currentSector, (isData ? sectortrace::Flags::DATA : 0) |
+                                                       (miss ? 0 : sectortrace::Flags::HIT) |
+                                                       (s_sectorCache.isStreaming() ? sectortrace::Flags::STREAM : 0));
+#endif
             }
 
-            if (cache_hit == -1) {
-                g_discImage.readData(cdSamples[roundRobinCacheIndex], currentSector - c_leadIn - c_preGap);
-
-                cachedSectors[roundRobinCacheIndex] = currentSector;
-                cache_hit = roundRobinCacheIndex;
-                roundRobinCacheIndex = (roundRobinCacheIndex + 1) % c_sectorCacheSize;
-            }
-
-            const int16_t *data = reinterpret_cast<int16_t *>(cdSamples[cache_hit]);
-            const unsigned abs_lev_chselect = (currentSector % 2);
             // Copy CD samples to PIO buffer
-            for (int i = 0; i < c_cdSamplesSize * 2; i++) {
-                uint32_t i2s_data;
-
-                if (g_discImage.isCurrentTrackData()) {
-                    i2s_data = (cdSamples[cache_hit][i] ^ cdScramblingKey[i]) << 8;
-                } else {
-                    i2s_data = (cdSamples[cache_hit][i]) << 8;
-                    // g_audioPeak = blah;
-                    // g_audioLevel = blah;
-                }
-
-                if (i2s_data & 0x100) {
-                    i2s_data |= 0xFF;
-                }
-
-                pioSamples[bufferForSDRead][i] = i2s_data;
+            uint32_t *samples = s_pioSamples[bufferForSDRead];
+            if (isData) {
+                samplecopy::copyData(samples, sectorData, s_scramblingKey);
+            } else {
+                int32_t peakLeft;
+                int32_t peakRight;
+                samplecopy::copyAudio(samples, sectorData, &peakLeft, &peakRight);
+
+                const unsigned abs_lev_chselect = (currentSector % 2);
+                const int32_t level = abs_lev_chselect ? peakRight : peakLeft;
+                g_audioLevel = std::min<int32_t>(level, 0x7FFF) | (abs_lev_chselect << 15);
+                heldPeak = std::min<int32_t>(std::max({heldPeak, peakLeft, peakRight}), 0x7FFF);
+                g_audioPeak = heldPeak;
             }
 
             loadedSector[bufferForSDRead] = currentSector;
             bufferForSDRead = (bufferForSDRead + 1) % 2;
+#if DEBUG_I2S
+            readySlackUs = (int64_t)(dmaStartTime + sectorUs) - (int64_t)time_us_64();
+#endif
+        } else if ((int64_t)(dmaStartTime + sectorUs) - (int64_t)time_us_64() >= readCostUs + c_swapMarginUs) {
+            // Next buffer is ready and even a slow read would finish before the swap
+            if (prefetchRemaining > 0) {
+                // Warm the cache at the seek target while the current sector plays
+                const uint64_t readStart = time_us_64();
+                const bool read = s_sectorCache.prefetch(prefetchSector);
+                if (read) {
+                    readCostUs = std::max<int64_t>(time_us_64() - readStart, readCostUs);
+                }
+#if PICOSTATION_SECTOR_TRACE
+                sectortrace::record(prefetchSector,
+                                    sectortrace::Flags::PREFETCH | (read ? 0 : sectortrace::Flags::HIT));
+#endif
+                prefetchSector++;
+                prefetchRemaining--;
+            } else {
+                // Work that can wait. At 2x the verify reads are left for 1x.
+                if (speed > 1) {
+                    if (config.psnee) {
+                        psnee(currentSector);
+                    }
+                } else if (!s_sectorCache.isStreaming()) {
+                    s_imageVerifier.step();  // One sector per pass, between the console's reads
+                }
+#if PICOSTATION_SECTOR_TRACE
+                sectortrace::flush();  // 1 KB writes fit in the time left, streams have to be traced too
+#endif
+#if DEBUG_I2S
+                printBusStats();
+#endif
+            }
         }
 
         if (!dma_channel_is_busy(dmaChannel)) {
+#if DEBUG_I2S
+            recordSlack(speed, bufferForDMA == bufferForSDRead, readySlackUs);
+#endif
+            // Follows a slow read at once and forgets it over a few sectors
+            readCostUs = std::max(c_minReadCostUs, readCostUs - readCostUs / 16);
             bufferForDMA = (bufferForDMA + 1) % 2;
             g_sectorSending = loadedSector[bufferForDMA];
+            __sev();  // Core0 sleeps until it sees the sector being sent
 
-            dma_hw->ch[dmaChannel].read_addr = (uint32_t)pioSamples[bufferForDMA];
+            dma_hw->ch[dmaChannel].read_addr = (uint32_t)s_pioSamples[bufferForDMA];
 
             // Sync with the I2S clock
             while (gpio_get(Pin::LRCK) == 1) {
@@ -207,12 +462,15 @@ inline int picostation::I2S::initDMA(const volatile void *read_addr, uint transf
             }
 
             dma_channel_start(dmaChannel);
+            dmaStartTime = time_us_64();
         }
     }
     __builtin_unreachable();
 }
 
-void picostation::I2S::psnee(const int sector) {
+// Sends the SCEx string once the console has sat in the lead-in for a while: a 90 ms low, then 6 times the 44 bits
+// at 4 ms each and another 90 ms low. A step per call, so a burst never holds up a sector.
+void __time_critical_func(picostation::I2S::psnee)(const int sector) {
     static constexpr int PSNEE_SECTOR_LIMIT = c_leadIn;
     static constexpr char SCEX_DATA[][44] = {
         {1, 0, 0, 1, 1, 0, 1, 0, 1, 0, 0, 1, 0, 0, 1, 1, 1, 1, 0, 1, 0, 0,
@@ -222,47 +480,45 @@ void picostation::I2S::psnee(const int sector) {
         {1, 0, 0, 1, 1, 0, 1, 0, 1, 0, 0, 1, 0, 0, 1, 1, 1, 1, 0, 1, 0, 0,
          1, 0, 1, 0, 1, 1, 1, 0, 1, 0, 0, 1, 0, 1, 1, 0, 1, 1, 0, 1, 0, 0},
     };
+    static constexpr int c_burstSteps = 44 + 1;           // The bits and the low after them
+    static constexpr int c_steps = 1 + 6 * c_burstSteps;  // The first low, then the bursts
 
     static int psnee_hysteresis = 0;
+    static int step = -1;  // -1 while counting
 
-    if (sector > 0 && sector < PSNEE_SECTOR_LIMIT && mechcommand::getSens(SENS::GFS) && !g_soctEnabled.Load() &&
-        g_discImage.hasData() && ((time_us_64() - s_psneeTimer) > 13333)) {
-        psnee_hysteresis++;
-        s_psneeTimer = time_us_64();
-    }
-
-    if (psnee_hysteresis > 100) {
-        psnee_hysteresis = 0;
-        DEBUG_PRINT("+SCEX\n");
-        gpio_put(Pin::SCEX_DATA, 0);
-        s_psneeTimer = time_us_64();
-        while ((time_us_64() - s_psneeTimer) < 90000) {
-            if (sector >= PSNEE_SECTOR_LIMIT || g_soctEnabled.Load()) {
-                goto abort_psnee;
-            }
+    if (step < 0) {
+        if (sector > 0 && sector < PSNEE_SECTOR_LIMIT && mechcommand::getSens(SENS::GFS) && !g_soctEnabled.Load() &&
+            g_discImage.hasData() && ((time_us_64() - s_psneeTimer) > 13333)) {
+            psnee_hysteresis++;
+            s_psneeTimer = time_us_64();
         }
-        for (int i = 0; i < 6; i++) {
-            for (int j = 0; j < 44; j++) {
-                gpio_put(Pin::SCEX_DATA, SCEX_DATA[i % 3][j]);
-                s_psneeTimer = time_us_64();
-                while ((time_us_64() - s_psneeTimer) < 4000) {
-                    if (sector >= PSNEE_SECTOR_LIMIT || g_soctEnabled.Load()) {
-                        goto abort_psnee;
-                    }
-                }
-            }
+
+        if (psnee_hysteresis > 100) {
+            psnee_hysteresis = 0;
+            DEBUG_PRINT("+SCEX\n");
             gpio_put(Pin::SCEX_DATA, 0);
             s_psneeTimer = time_us_64();
-            while ((time_us_64() - s_psneeTimer) < 90000) {
-                if (sector >= PSNEE_SECTOR_LIMIT || g_soctEnabled.Load()) {
-                    goto abort_psnee;
-                }
-            }
+            step = 0;
         }
+        return;
+    }
 
-    abort_psnee:
+    const bool abort = sector >= PSNEE_SECTOR_LIMIT || g_soctEnabled.Load();
+    const bool isBit = step > 0 && (step - 1) % c_burstSteps < 44;
+    if (!abort && (time_us_64() - s_psneeTimer) < (isBit ? 4000u : 90000u)) {
+        return;
+    }
+
+    step++;
+    if (abort || step == c_steps) {
+        step = -1;
         gpio_put(Pin::SCEX_DATA, 0);
         s_psneeTimer = time_us_64();
         DEBUG_PRINT("-SCEX\n");
+        return;
     }
+    const int burst = (step - 1) / c_burstSteps;
+    const int bit = (step - 1) % c_burstSteps;
+    gpio_put(Pin::SCEX_DATA, bit < 44 ? SCEX_DATA[burst % 3][bit] : 0);
+    s_psneeTimer = time_us_64();
 }
\ No newline at end of file
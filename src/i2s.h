@@ -2,6 +2,7 @@
 
 #include <stdint.h>
 
+#include "ff.h"
 #include "pico/stdlib.h"
 
 namespace picostation {
@@ -14,7 +15,8 @@ class I2S {
   private:
     void generateScramblingKey(uint16_t *cdScramblingKey);
     int initDMA(const volatile void *read_addr, uint transfer_count);  // Returns DMA channel number
-    void mountSDCard();
+    FRESULT mountSDCard();
+    bool remountSDCard();
     void psnee(const int sector);
     void reset();
 };
@@ -0,0 +1,115 @@
+#include "image_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "logging.h"
+#include "seek_model.h"
+#include "utils.h"
+
+#if DEBUG_CUE
+#define DEBUG_PRINT(...) printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINT(...) while (0)
+#endif
+
+static constexpr picostation::ImageConfig::Settings c_defaults = {
+    .seekProfile = picostation::seekmodel::Profile::LEGACY,
+    .cacheSlots = 0,
+    .streamRun = 0,
+    .prefetchDepth = {4, 8},
+    .psnee = true,
+    .verify = false,
+};
+
+static constexpr const char *c_seekProfiles[picostation::seekmodel::Profile::COUNT] = {"legacy", "accurate", "fast"};
+
+static char *trim(char *text) {
+    while (*text == ' ' || *text == '\t') {
+        text++;
+    }
+    char *end = text + strlen(text);
+    while (end > text && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n')) {
+        end--;
+    }
+    *end = 0;
+    return text;
+}
+
+// Whole non-negative number, -1 otherwise
+static int parseCount(const char *value) {
+    char *end;
+    const long number = strtol(value, &end, 10);
+    return (end != value && *end == 0 && number >= 0 && number <= 0xFFFF) ? number : -1;
+}
+
+// on/off or 1/0, false if it is neither
+static bool parseSwitch(const char *value, bool *result) {
+    if (strcasecmp(value, "on") == 0 || strcmp(value, "1") == 0) {
+        *result = true;
+        return true;
+    }
+    if (strcasecmp(value, "off") == 0 || strcmp(value, "0") == 0) {
+        *result = false;
+        return true;
+    }
+    return false;
+}
+
+void picostation::ImageConfig::set(const char *key, const char *value) {
+    const int number = parseCount(value);
+    if (strcasecmp(key, "seek_profile") == 0) {
+        for (uint i = 0; i < seekmodel::Profile::COUNT; i++) {
+            if (strcasecmp(value, c_seekProfiles[i]) == 0 || number == (int)i) {
+                m_settings.seekProfile = i;
+                return;
+            }
+        }
+    } else if (strcasecmp(key, "cache_slots") == 0 && number > 0) {
+        m_settings.cacheSlots = number;
+        return;
+    } else if (strcasecmp(key, "stream_run") == 0 && number > 0) {
+        m_settings.streamRun = number;
+        return;
+    } else if (strcasecmp(key, "prefetch_depth") == 0 && number >= 0) {
+        m_settings.prefetchDepth[0] = number;
+        return;
+    } else if (strcasecmp(key, "prefetch_depth_2x") == 0 && number >= 0) {
+        m_settings.prefetchDepth[1] = number;
+        return;
+    } else if (strcasecmp(key, "psnee") == 0 && parseSwitch(value, &m_settings.psnee)) {
+        return;
+    } else if (strcasecmp(key, "verify") == 0 && parseSwitch(value, &m_settings.verify)) {
+        return;
+    }
+    DEBUG_PRINT("ini: ignored %s = %s\n", key, value);
+}
+
+void picostation::ImageConfig::load(const TCHAR *cuePath) {
+    m_settings = c_defaults;
+
+    TCHAR path[256];
+    replaceExtension(cuePath, ".ini", path, sizeof(path));
+
+    FIL file;
+    if (f_open(&file, path, FA_READ) != FR_OK) {
+        return;
+    }
+    char line[96];
+    while (f_gets(line, sizeof(line), &file)) {
+        line[strcspn(line, ";#")] = 0;
+        char *equals = strchr(line, '=');
+        if (!equals) {
+            continue;  // Blank, comment or [section]
+        }
+        *equals = 0;
+        set(trim(line), trim(equals + 1));
+    }
+    f_close(&file);
+    DEBUG_PRINT("%s: seek %s, cache %d, stream run %d, prefetch %d/%d, psnee %s, verify %s\n", path,
+                c_seekProfiles[m_settings.seekProfile], m_settings.cacheSlots, m_settings.streamRun,
+                m_settings.prefetchDepth[0], m_settings.prefetchDepth[1], m_settings.psnee ? "on" : "off",
+                m_settings.verify ? "on" : "off");
+}
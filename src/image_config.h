@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ff.h"
+#include "pico/stdlib.h"
+
+namespace picostation {
+// Tuning for a troublesome title, from an .ini file next to the cue sheet (<cue name>.ini). One "key = value"
+// per line, ; and # start comments, [sections] are ignored. Missing keys and bad values keep the defaults.
+//   seek_profile = legacy | accurate | fast
+//   cache_slots = main sector cache slots in use, at most the build's
+//   stream_run = sectors read in a row before the cache treats reads as a stream
+//   prefetch_depth = sectors read ahead at a seek target at 1x, prefetch_depth_2x the same at 2x
+//   psnee = on | off
+//   verify = on | off, checks the whole image in the background, see ImageVerifier
+class ImageConfig {
+  public:
+    struct Settings {
+        uint seekProfile;
+        int cacheSlots;        // 0: all of them
+        int streamRun;         // 0: SectorCache's default
+        int prefetchDepth[2];  // Indexed by speed - 1
+        bool psnee;
+        bool verify;
+    };
+
+    void load(const TCHAR *cuePath);  // Resets to the defaults first
+    const Settings &settings() const { return m_settings; }
+
+  private:
+    void set(const char *key, const char *value);
+
+    Settings m_settings;
+};
+}  // namespace picostation
@@ -0,0 +1,174 @@
+#include "image_verify.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <array>
+
+#include "edc_ecc.h"
+#include "logging.h"
+#include "pico/stdlib.h"
+#include "utils.h"
+
+#if DEBUG_CUE
+#define DEBUG_PRINT(...) printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINT(...) while (0)
+#endif
+
+// The sidecar is little endian: this header, fileCount FileEntry records in cue sheet FILE order, then the
+// checksums. A file the tool could not hash has no sectors.
+struct SidecarHeader {
+    char magic[4];  // "PSCK"
+    uint16_t version;
+    uint16_t fileCount;
+};
+
+// CRC-32 as in zlib, so the host tool can use zlib.crc32
+static constexpr std::array<uint32_t, 256> c_crcLut = [] {
+    std::array<uint32_t, 256> lut{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+        }
+        lut[i] = crc;
+    }
+    return lut;
+}();
+
+static uint32_t crc32(const uint8_t *data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc = (crc >> 8) ^ c_crcLut[(crc ^ data[i]) & 0xFF];
+    }
+    return ~crc;
+}
+
+void picostation::ImageVerifier::start(const TCHAR *cuePath, DiscImage *discImage) {
+    stop();
+    m_discImage = discImage;
+    replaceExtension(cuePath, "", m_path, sizeof(m_path));
+    m_next = 0;
+    m_stats = {};
+    m_windowFile = -1;
+    openSidecar();
+    m_running = true;
+}
+
+void picostation::ImageVerifier::stop() {
+    if (m_hasSidecar) {
+        f_close(&m_sidecar);
+        m_hasSidecar = false;
+    }
+    m_running = false;
+}
+
+void picostation::ImageVerifier::openSidecar() {
+    TCHAR path[sizeof(m_path) + 4];  // Room for the extension however long the path is
+    snprintf(path, sizeof(path), "%s.crc", m_path);
+    if (f_open(&m_sidecar, path, FA_READ) != FR_OK) {
+        return;
+    }
+    SidecarHeader header;
+    UINT br;
+    if (f_read(&m_sidecar, &header, sizeof(header), &br) != FR_OK || br != sizeof(header) ||
+        memcmp(header.magic, "PSCK", 4) != 0 || header.version != 1 || header.fileCount > c_maxFiles ||
+        f_read(&m_sidecar, m_files, header.fileCount * sizeof(FileEntry), &br) != FR_OK ||
+        br != header.fileCount * sizeof(FileEntry)) {
+        DEBUG_PRINT("%s: not a checksum file\n", path);
+        f_close(&m_sidecar);
+        return;
+    }
+    m_fileCount = header.fileCount;
+    m_hasSidecar = true;
+}
+
+bool picostation::ImageVerifier::expectedChecksum(const DiscImage::Location &location, uint32_t *checksum) {
+    if (!m_hasSidecar || location.file >= m_fileCount) {
+        return false;
+    }
+    const FileEntry &file = m_files[location.file];
+    if (file.sectorSize != location.sectorSize || (uint32_t)location.index >= file.sectorCount) {
+        return false;
+    }
+    if (m_windowFile != location.file || (uint32_t)location.index < m_windowStart ||
+        (uint32_t)location.index >= m_windowStart + c_windowSize) {
+        m_windowFile = -1;
+        m_windowStart = location.index - location.index % c_windowSize;
+        UINT br;
+        if (f_lseek(&m_sidecar, file.offset + m_windowStart * sizeof(uint32_t)) != FR_OK ||
+            f_read(&m_sidecar, m_window, sizeof(m_window), &br) != FR_OK) {
+            return false;
+        }
+        m_windowFile = location.file;
+    }
+    *checksum = m_window[location.index - m_windowStart];
+    return true;
+}
+
+void picostation::ImageVerifier::step() {
+    if (!m_running) {
+        return;
+    }
+    if (m_next >= m_discImage->sectorCount()) {
+        finish();
+        return;
+    }
+
+    const int lba = m_next++;
+    DiscImage::Location location;
+    if (!m_discImage->locate(lba, &location)) {
+        return;  // Generated, nothing to check
+    }
+
+    uint32_t expected;
+    const bool hasChecksum = expectedChecksum(location, &expected);
+    if (!hasChecksum && (location.encoded || !location.isData || location.sectorSize != c_cdSamplesBytes)) {
+        m_stats.unverified++;  // Audio has no EDC and cooked or decoded sectors get theirs rebuilt
+        return;
+    }
+
+    if (!m_discImage->readData(m_sector, lba)) {
+        m_stats.unverified++;  // The card's fault rather than the image's, DiscImage counts it
+        return;
+    }
+    bool good;
+    if (hasChecksum) {
+        // The stored bytes: the whole raw sector, or the cooked part readData placed after the header
+        const uint8_t *stored = location.sectorSize == c_cdSamplesBytes ? m_sector : m_sector + 16;
+        good = crc32(stored, location.sectorSize) == expected;
+    } else {
+        good = edcecc::checkEDC(m_sector);
+    }
+    m_stats.checked++;
+    if (!good) {
+        if (m_stats.bad < c_maxBadListed) {
+            m_badLbas[m_stats.bad] = lba;
+        }
+        m_stats.bad++;
+        DEBUG_PRINT("verify: bad sector %d (%s)\n", lba, hasChecksum ? "checksum" : "EDC");
+    }
+}
+
+void picostation::ImageVerifier::finish() {
+    stop();
+    DEBUG_PRINT("verify: %s, %u sectors checked, %u bad, %u unverified\n", m_path, (unsigned)m_stats.checked,
+                (unsigned)m_stats.bad, (unsigned)m_stats.unverified);
+
+    TCHAR path[sizeof(m_path) + 4];
+    snprintf(path, sizeof(path), "%s.bad", m_path);
+    if (m_stats.bad == 0) {
+        f_unlink(path);  // Left over from a copy of the image that has been replaced since
+        return;
+    }
+    FIL file;
+    if (f_open(&file, path, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) {
+        return;
+    }
+    f_printf(&file, "# %u bad of %u checked\n", (unsigned)m_stats.bad, (unsigned)m_stats.checked);
+    for (uint32_t i = 0; i < m_stats.bad && i < c_maxBadListed; i++) {
+        f_printf(&file, "%d\n", m_badLbas[i]);
+    }
+    f_close(&file);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "disc_image.h"
+#include "ff.h"
+#include "values.h"
+
+namespace picostation {
+// Walks the loaded image a sector at a time while core1 has nothing better to do, so bad rips and corrupted
+// copies show up in the log instead of as random freezes. Sectors are compared with the CRC-32s that
+// tools/make_crc.py stores in <cue name>.crc, raw data sectors without one are checked against their EDC. Bad
+// sectors are logged and listed in <cue name>.bad at the end of the pass.
+class ImageVerifier {
+  public:
+    static constexpr int c_maxFiles = 99;
+    static constexpr int c_maxBadListed = 64;
+
+    struct Stats {
+        uint32_t checked;
+        uint32_t bad;
+        uint32_t unverified;  // Audio and cooked or encoded sectors without a checksum, failed reads
+    };
+
+    void start(const TCHAR *cuePath, DiscImage *discImage);  // Begins a pass over the loaded image
+    void stop();
+    void step();  // Checks the next sector, nothing once the pass is done
+    bool isRunning() const { return m_running; }
+    Stats getStats() const { return m_stats; }
+
+  private:
+    struct FileEntry {
+        uint32_t offset;  // Of the first checksum in the .crc file
+        uint32_t sectorCount;
+        uint16_t sectorSize;
+        uint16_t reserved;
+    };
+    static constexpr int c_windowSize = 128;
+
+    void openSidecar();
+    bool expectedChecksum(const DiscImage::Location &location, uint32_t *checksum);
+    void finish();
+
+    DiscImage *m_discImage = nullptr;
+    TCHAR m_path[256];  // Cue sheet path without the extension
+    bool m_running = false;
+    int m_next = 0;
+    Stats m_stats = {};
+    FIL m_sidecar;
+    bool m_hasSidecar = false;
+    int m_fileCount = 0;
+    FileEntry m_files[c_maxFiles];
+    uint32_t m_window[c_windowSize];  // Checksums read ahead from the sidecar
+    int m_windowFile = -1;
+    uint32_t m_windowStart = 0;
+    int m_badLbas[c_maxBadListed];
+    uint8_t m_sector[c_cdSamplesBytes];
+};
+}  // namespace picostation
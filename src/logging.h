@@ -4,6 +4,8 @@
 #define DEBUG_CUE 0
 #define DEBUG_I2S 0
 #define DEBUG_MAIN 0
+#define DEBUG_MEM 0
+#define DEBUG_SD 0
 #define DEBUG_SUBQ 0
 
-#define DEBUG_LOGGING_ENABLED (DEBUG_CMD | DEBUG_CUE | DEBUG_I2S | DEBUG_MAIN | DEBUG_SUBQ)
+#define DEBUG_LOGGING_ENABLED (DEBUG_CMD | DEBUG_CUE | DEBUG_I2S | DEBUG_MAIN | DEBUG_MEM | DEBUG_SD | DEBUG_SUBQ)
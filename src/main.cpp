@@ -1,9 +1,11 @@
+#include "mem_stats.h"
 #include "pico/multicore.h"
 #include "pico/stdlib.h"
 #include "picostation.h"
 #include "third_party/RP2040_Pseudo_Atomic/Inc/RP2040Atomic.hpp"
 
 int main() {
+    picostation::memstats::paintStack();
     set_sys_clock_khz(271200, true);
     sleep_ms(5);
 
@@ -0,0 +1,83 @@
+#include "mem_stats.h"
+
+#include <malloc.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "pico/stdlib.h"
+
+#if PICO_ON_DEVICE
+#include "hardware/sync.h"
+
+// Linker script symbols (memmap_default.ld)
+extern char __data_start__, __data_end__, __bss_start__, __bss_end__;
+extern char __scratch_x_start__, __scratch_x_end__, __scratch_y_start__, __scratch_y_end__;
+extern char __StackBottom, __StackTop, __StackOneBottom, __StackOneTop;
+extern char __end__, __StackLimit;
+
+static constexpr uint32_t c_paint = 0x5A7C5A7C;
+static constexpr size_t c_paintMargin = 64;  // Below the painter's own frame, left alone
+static bool s_painted[2];
+
+static uint32_t *stackBottom(const unsigned core) {
+    return (uint32_t *)(core ? &__StackOneBottom : &__StackBottom);
+}
+
+static uint32_t *stackTop(const unsigned core) { return (uint32_t *)(core ? &__StackOneTop : &__StackTop); }
+#endif
+
+void picostation::memstats::paintStack() {
+#if PICO_ON_DEVICE
+    const unsigned core = get_core_num();
+    uint32_t *sp;
+    asm volatile("mov %0, sp" : "=r"(sp));
+    for (uint32_t *p = stackBottom(core); p < sp - c_paintMargin / sizeof(uint32_t); p++) {
+        *p = c_paint;
+    }
+    s_painted[core] = true;
+#endif
+}
+
+picostation::memstats::StackStats picostation::memstats::getStackStats(const unsigned core) {
+#if PICO_ON_DEVICE
+    const uint32_t *bottom = stackBottom(core);
+    const uint32_t *top = stackTop(core);
+    StackStats stats = {(size_t)(top - bottom) * sizeof(uint32_t), 0};
+    if (s_painted[core]) {
+        const uint32_t *p = bottom;
+        while (p < top && *p == c_paint) {
+            p++;
+        }
+        stats.peak = (size_t)(top - p) * sizeof(uint32_t);
+    }
+    return stats;
+#else
+    return {0, 0};
+#endif
+}
+
+picostation::memstats::HeapStats picostation::memstats::getHeapStats() {
+    const struct mallinfo info = mallinfo();
+    HeapStats stats = {(size_t)info.uordblks, (size_t)info.fordblks, (size_t)info.arena, (size_t)info.keepcost};
+#if PICO_ON_DEVICE
+    const char *brk = (const char *)sbrk(0);
+    stats.largestFree += &__StackLimit - brk;
+#endif
+    return stats;
+}
+
+void picostation::memstats::report() {
+#if PICO_ON_DEVICE
+    printf("mem: data %u, bss %u, scratch_x %u, scratch_y %u, heap region %u\n",
+           (unsigned)(&__data_end__ - &__data_start__), (unsigned)(&__bss_end__ - &__bss_start__),
+           (unsigned)(&__scratch_x_end__ - &__scratch_x_start__),
+           (unsigned)(&__scratch_y_end__ - &__scratch_y_start__), (unsigned)(&__StackLimit - &__end__));
+    for (unsigned core = 0; core < 2; core++) {
+        const StackStats stack = getStackStats(core);
+        printf("mem: core%u stack %u / %u\n", core, (unsigned)stack.peak, (unsigned)stack.size);
+    }
+#endif
+    const HeapStats heap = getHeapStats();
+    printf("mem: heap used %u, free in arena %u, arena %u, largest free >= %u\n", (unsigned)heap.used,
+           (unsigned)heap.freeInArena, (unsigned)heap.arena, (unsigned)heap.largestFree);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace picostation {
+namespace memstats {
+struct StackStats {
+    size_t size;
+    size_t peak;  // High-water mark since the stack was painted, 0 if it never was
+};
+
+struct HeapStats {
+    size_t used;         // Allocated bytes
+    size_t freeInArena;  // Freed bytes malloc can reuse, possibly fragmented
+    size_t arena;        // Bytes taken from sbrk, the heap's high-water mark
+    size_t largestFree;  // Lower bound: the unclaimed tail plus malloc's top chunk
+};
+
+// Fills the calling core's unused stack with a pattern, call first thing on each core
+void paintStack();
+StackStats getStackStats(const unsigned core);
+HeapStats getHeapStats();
+
+// Static sections per region, both stacks and the heap over stdout (the debug UART)
+void report();
+}  // namespace memstats
+}  // namespace picostation
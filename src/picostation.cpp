@@ -10,7 +10,9 @@
 #include "i2s.h"
 #include "logging.h"
 #include "main.pio.h"
+#include "mem_stats.h"
 #include "pico/multicore.h"
+#include "seek_model.h"
 #include "subq.h"
 #include "third_party/RP2040_Pseudo_Atomic/Inc/RP2040Atomic.hpp"
 #include "utils.h"
@@ -24,11 +26,9 @@
 
 // To-do: Establish thread safety: identify variables that are shared between cores, wrap them in mutexes or spin locks,
 // maybe in a class?
-// To-do: Implement lid switch behavior
 // To-do: Implement a console side menu to select the cue file
 // To-do: Implement level meter mode to command $AX - AudioCTRL
 // To-do: Implement UART(250 baud) for psnee
-// To-do: Fix seeks that go into the lead-in + track 1 pregap areas, possibly sending bad data over I2S
 
 patom::types::patomic_bool picostation::g_soctEnabled;  // core0: r/w, core1: r
 uint picostation::g_countTrack = 0;                     // core0: r/w, move to class?
@@ -41,18 +41,23 @@ uint64_t picostation::g_sledTimer = 0;                  // core0: r/w, move to c
 patom::types::patomic_int picostation::g_sector;         // core0: r/w, core1: r
 int picostation::g_sectorForTrackUpdate = 0;             // core0: r/w, move to class?
 patom::types::patomic_int picostation::g_sectorSending;  // core0: r, core1: w
+patom::types::patomic_int picostation::g_prefetchSector;  // seek target, mechacon: w, core1: r/w
 
 bool picostation::g_subqDelay = false;  // core0: r/w
+// core1 holds SubQ while it loads an image, core0 marks the frames it is generating, so neither runs during the other
+patom::types::patomic_bool picostation::g_discLoading;  // core0: r, core1: w
+patom::types::patomic_bool picostation::g_subqBusy;     // core0: w, core1: r
 
 static int s_currentPlaybackSpeed = 1;
-int picostation::g_targetPlaybackSpeed = 1;  // core0: r/w
+int picostation::g_targetPlaybackSpeed = 1;              // core0: r/w
+patom::types::patomic_int picostation::g_playbackSpeed;  // What the clocks run at, core0: w, core1: r
 
-mutex_t picostation::g_mechaconMutex;
 bool picostation::g_coreReady[2] = {false, false};
 
 uint picostation::g_audioCtrlMode = audioControlModes::NORMAL;
-// volatile int32_t picostation::g_audioPeak = 0;
-// volatile int32_t picostation::g_audioLevel = 0;
+volatile int32_t picostation::g_audioPeak = 0;         // Held since the last NORMAL mode, core0: r, core1: w
+volatile int32_t picostation::g_audioLevel = 0;        // Last audio sector, bit 15 = channel, core0: r, core1: w
+volatile uint32_t picostation::g_audioPeakResets = 0;  // NORMAL modes set so far, core0: w, core1: r
 
 static uint s_mechachonOffset;
 uint picostation::g_soctOffset;
@@ -68,27 +73,56 @@ static picostation::PWMSettings pwmMainClock = {.gpio = Pin::CLK, .wrap = 1, .cl
 
 static void initPWM(picostation::PWMSettings *settings);
 
+// Progress of a reset, see maybeReset()
+namespace ResetState {
+enum : uint8_t {
+    IDLE,
+    WAIT_RESET,   // Until RESET has been high for c_resetQuietTime
+    WAIT_CMD_CK,  // Then until CMD_CK has been idle for as long
+};
+}
+
+static constexpr uint c_resetQuietTime = 30000;  // uS
+static uint8_t s_resetState = ResetState::IDLE;
+static uint64_t s_resetQuietSince = 0;
+static volatile uint32_t s_resetEdges = 0;     // Rising ones only in WAIT_RESET, gpioCallback: w, core0: r
+static volatile uint32_t s_cmdClockEdges = 0;  // Only in WAIT_CMD_CK, gpioCallback: w, core0: r
+static uint32_t s_resetEdgesSeen = 0;
+static uint32_t s_cmdClockEdgesSeen = 0;
+
+// XLAT decodes the latched command. RESET and CMD_CK edges are only counted, which catches pulses shorter than a
+// pass of the main loop, and wake core0 for maybeReset().
+static void __time_critical_func(gpioCallback)(uint gpio, uint32_t events) {
+    if (gpio == Pin::XLAT) {
+        picostation::mechcommand::interrupt_xlat(gpio, events);
+    } else if (gpio == Pin::RESET) {
+        s_resetEdges++;
+    } else if (gpio == Pin::CMD_CK) {
+        s_cmdClockEdges++;
+    }
+}
+
+// Events either arrive as interrupts (mechacon commands, RESET, alarms) or from core1, which raises an event when it
+// starts sending a sector. Between them core0 sleeps until the earliest pending deadline.
 [[noreturn]] void __time_critical_func(picostation::core0Entry)() {
-    static constexpr uint c_MaxTrackMoveTime = 15;    // uS
     static constexpr uint c_MaxSubqDelayTime = 3333;  // uS
+    static constexpr uint c_soctTime = 300;           // uS, waiting for RX FIFO entry does not work
 
     SubQ subq(&g_discImage);
     uint64_t subqDelayTime = 0;
+    uint64_t soctStartTime = 0;
+    bool soctRunning = false;
 
-    int sector_per_track = sectorsPerTrack(0);
+    int sector_per_track = seekmodel::sectorsPerTrack(0);
 
+    g_playbackSpeed = s_currentPlaybackSpeed;
     g_coreReady[0] = true;
     while (!g_coreReady[1]) {
         tight_loop_contents();
     }
 
     while (true) {
-        // Update latching, output SENS
-        if (mutex_try_enter(&g_mechaconMutex, 0)) {
-            mechcommand::updateMechSens();
-            mutex_exit(&g_mechaconMutex);
-        }
-
+        uint64_t deadline = UINT64_MAX;
         const auto currentSector = g_sector.Load();
 
         // Limit Switch
@@ -96,21 +130,30 @@ static void initPWM(picostation::PWMSettings *settings);
 
         updatePlaybackSpeed();
 
-        // Check for reset signal
-        maybeReset();
+        // Check for reset signal, nothing else runs until the mechacon is back
+        if (maybeReset(&deadline)) {
+            best_effort_wfe_or_timeout(from_us_since_boot(deadline));
+            continue;
+        }
 
         // Soct/Sled/seek
         if (g_soctEnabled.Load()) {
-            uint interrupts = save_and_disable_interrupts();
-            // waiting for RX FIFO entry does not work.
-            sleep_us(300);
-            g_soctEnabled = false;
-            pio_sm_set_enabled(PIOInstance::SOCT, SM::SOCT, false);
-            restore_interrupts(interrupts);
+            if (!soctRunning) {
+                soctRunning = true;
+                soctStartTime = time_us_64();
+            }
+            if ((time_us_64() - soctStartTime) >= c_soctTime) {
+                pio_sm_set_enabled(PIOInstance::SOCT, SM::SOCT, false);
+                g_soctEnabled = false;
+                soctRunning = false;
+                continue;
+            }
+            deadline = soctStartTime + c_soctTime;
         } else if (g_sledMoveDirection != SledMove::STOP) {
-            if ((time_us_64() - g_sledTimer) > c_MaxTrackMoveTime) {
+            soctRunning = false;
+            if ((time_us_64() - g_sledTimer) > seekmodel::sledStepUs()) {
                 g_track = clamp(g_track + g_sledMoveDirection, c_trackMin, c_trackMax);  // +1 or -1
-                g_sectorForTrackUpdate = trackToSector(g_track);
+                g_sectorForTrackUpdate = seekmodel::trackToSector(g_track);
                 g_sector = g_sectorForTrackUpdate;
 
                 const int tracks_moved = g_track - g_originalTrack;
@@ -121,20 +164,29 @@ static void initPWM(picostation::PWMSettings *settings);
 
                 g_sledTimer = time_us_64();
             }
+            deadline = g_sledTimer + seekmodel::sledStepUs() + 1;
         } else if (mechcommand::getSens(SENS::GFS)) {
+            soctRunning = false;
             if (g_subqDelay) {
                 if ((time_us_64() - subqDelayTime) > c_MaxSubqDelayTime) {
                     g_subqDelay = false;
-                    subq.start_subq(currentSector);
-
-                    gpio_put(Pin::SCOR, 1);
-                    add_alarm_in_us(
-                        135,
-                        [](alarm_id_t id, void *user_data) -> int64_t {
-                            gpio_put(Pin::SCOR, 0);
-                            return 0;
-                        },
-                        NULL, true);
+                    // The frame is dropped while core1 rewrites the disc layout generateSubQ reads
+                    g_subqBusy = true;
+                    if (!g_discLoading.Load()) {
+                        subq.start_subq(currentSector);
+
+                        gpio_put(Pin::SCOR, 1);
+                        add_alarm_in_us(
+                            135,
+                            [](alarm_id_t id, void *user_data) -> int64_t {
+                                gpio_put(Pin::SCOR, 0);
+                                return 0;
+                            },
+                            NULL, true);
+                    }
+                    g_subqBusy = false;
+                } else {
+                    deadline = subqDelayTime + c_MaxSubqDelayTime + 1;
                 }
             } else if (g_sectorSending.Load() == currentSector) {
                 g_sector = clamp(currentSector + 1, c_sectorMin, c_sectorMax);
@@ -142,16 +194,23 @@ static void initPWM(picostation::PWMSettings *settings);
                 {
                     g_sectorForTrackUpdate = currentSector;
                     g_track = clamp(g_track + 1, c_trackMin, c_trackMax);
-                    sector_per_track = sectorsPerTrack(g_track);
+                    sector_per_track = seekmodel::sectorsPerTrack(g_track);
                 }
                 g_subqDelay = true;
                 subqDelayTime = time_us_64();
+                continue;
             }
+        } else {
+            soctRunning = false;
         }
+
+        // Wakes early on any interrupt or core1's event, the loop then re-checks everything
+        best_effort_wfe_or_timeout(deadline == UINT64_MAX ? at_the_end_of_time : from_us_since_boot(deadline));
     }
 }
 
 [[noreturn]] void picostation::core1Entry() {
+    memstats::paintStack();
     I2S g_i2s;
 
     g_i2s.start();
@@ -176,8 +235,6 @@ void picostation::initHW() {
     // guaranteed to be random.
     srand(time_us_32());
 
-    mutex_init(&g_mechaconMutex);
-
     for (const auto pin : Pin::allPins) {
         gpio_init(pin);
     }
@@ -240,7 +297,9 @@ void picostation::initHW() {
         }
     }
 
-    gpio_set_irq_enabled_with_callback(Pin::XLAT, GPIO_IRQ_EDGE_FALL, true, &mechcommand::interrupt_xlat);
+    gpio_set_irq_enabled_with_callback(Pin::XLAT, GPIO_IRQ_EDGE_FALL, true, &gpioCallback);
+    gpio_set_irq_enabled(Pin::RESET, GPIO_IRQ_EDGE_FALL, true);
+    mechcommand::enableCaptureIRQ();
     pio_sm_set_enabled(PIOInstance::MECHACON, SM::MECHACON, true);
     DEBUG_PRINT("ON!\n");
 }
@@ -257,7 +316,7 @@ void initPWM(picostation::PWMSettings *settings) {
     pwm_set_both_levels(settings->sliceNum, settings->level, settings->level);
 }
 
-void picostation::updatePlaybackSpeed() {
+void __time_critical_func(picostation::updatePlaybackSpeed)() {
     if (s_currentPlaybackSpeed != g_targetPlaybackSpeed) {
         s_currentPlaybackSpeed = g_targetPlaybackSpeed;
         const uint clock_div = (s_currentPlaybackSpeed == 1) ? 4 : 2;
@@ -267,38 +326,72 @@ void picostation::updatePlaybackSpeed() {
         pwm_hw->slice[pwmDataClock.sliceNum].div = pwmDataClock.config.div;
         pwm_hw->slice[pwmLRClock.sliceNum].div = pwmLRClock.config.div;
         pwm_set_mask_enabled((1 << pwmLRClock.sliceNum) | (1 << pwmDataClock.sliceNum) | (1 << pwmMainClock.sliceNum));
+        g_playbackSpeed = s_currentPlaybackSpeed;
         DEBUG_PRINT("x%i\n", s_currentPlaybackSpeed);
     }
 }
 
-void picostation::maybeReset() {
-    if (gpio_get(Pin::RESET) == 0) {
-        DEBUG_PRINT("RESET!\n");
-        pio_sm_set_enabled(PIOInstance::SUBQ, SM::SUBQ, false);
-        pio_sm_set_enabled(PIOInstance::SOCT, SM::SOCT, false);
-        pio_sm_restart(PIOInstance::MECHACON, SM::MECHACON);
-
-        mechacon_program_init(PIOInstance::MECHACON, SM::MECHACON, s_mechachonOffset, Pin::CMD_DATA);
-        g_subqDelay = false;
-        g_soctEnabled = false;
-
-        gpio_put(Pin::SCOR, 0);
-        gpio_put(Pin::SQSO, 0);
+// Stops the mechacon SM on RESET and starts it again once RESET has been high and CMD_CK idle for
+// c_resetQuietTime. The waits are polled from the main loop: returns true while one is in progress, with deadline
+// lowered to when it next has to look.
+bool __time_critical_func(picostation::maybeReset)(uint64_t *deadline) {
+    const uint64_t now = time_us_64();
+    const uint32_t resetEdges = s_resetEdges;
+    const bool resetActive = gpio_get(Pin::RESET) == 0 || resetEdges != s_resetEdgesSeen;
+    s_resetEdgesSeen = resetEdges;
+
+    switch (s_resetState) {
+        case ResetState::IDLE:
+            if (!resetActive) {
+                return false;
+            }
+            DEBUG_PRINT("RESET!\n");
+            pio_sm_set_enabled(PIOInstance::SUBQ, SM::SUBQ, false);
+            pio_sm_set_enabled(PIOInstance::SOCT, SM::SOCT, false);
+            pio_sm_restart(PIOInstance::MECHACON, SM::MECHACON);
 
-        uint64_t start_time = time_us_64();
+            mechacon_program_init(PIOInstance::MECHACON, SM::MECHACON, s_mechachonOffset, Pin::CMD_DATA);
+            g_subqDelay = false;
+            g_soctEnabled = false;
 
-        while ((time_us_64() - start_time) < 30000) {
-            if (gpio_get(Pin::RESET) == 0) {
-                start_time = time_us_64();
+            gpio_put(Pin::SCOR, 0);
+            gpio_put(Pin::SQSO, 0);
+
+            // The rise counts too, so the quiet time starts from it rather than from the last look at the level
+            gpio_set_irq_enabled(Pin::RESET, GPIO_IRQ_EDGE_RISE, true);
+            s_resetState = ResetState::WAIT_RESET;
+            s_resetQuietSince = now;
+            break;
+
+        case ResetState::WAIT_RESET:
+            if (resetActive) {
+                s_resetQuietSince = now;
+            } else if ((now - s_resetQuietSince) >= c_resetQuietTime) {
+                // CMD_CK's quiet time runs on from RESET's, as it did when this was a busy-wait
+                gpio_set_irq_enabled(Pin::RESET, GPIO_IRQ_EDGE_RISE, false);
+                s_resetState = ResetState::WAIT_CMD_CK;
+                s_cmdClockEdgesSeen = s_cmdClockEdges;
+                gpio_set_irq_enabled(Pin::CMD_CK, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true);
+                return maybeReset(deadline);
             }
-        }
-
-        while ((time_us_64() - start_time) < 30000) {
-            if (gpio_get(Pin::CMD_CK) == 0) {
-                start_time = time_us_64();
+            break;
+
+        case ResetState::WAIT_CMD_CK: {
+            const uint32_t cmdClockEdges = s_cmdClockEdges;
+            if (gpio_get(Pin::CMD_CK) == 0 || cmdClockEdges != s_cmdClockEdgesSeen) {
+                s_resetQuietSince = now;
+            } else if ((now - s_resetQuietSince) >= c_resetQuietTime) {
+                gpio_set_irq_enabled(Pin::CMD_CK, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, false);
+                pio_sm_set_enabled(PIOInstance::MECHACON, SM::MECHACON, true);
+                s_resetState = ResetState::IDLE;
+                return false;
             }
+            s_cmdClockEdgesSeen = cmdClockEdges;
+            break;
         }
-
-        pio_sm_set_enabled(PIOInstance::MECHACON, SM::MECHACON, true);
     }
+
+    // A level that stays low has no edge to wake core0, so look again when the quiet time would end
+    *deadline = MIN(*deadline, s_resetQuietSince + c_resetQuietTime);
+    return true;
 }
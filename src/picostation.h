@@ -23,7 +23,6 @@ struct PWMSettings {
     const uint16_t level;
 };
 
-extern mutex_t g_mechaconMutex;
 extern bool g_coreReady[2];
 
 extern uint g_soctOffset;
@@ -35,19 +34,24 @@ extern int g_originalTrack;
 extern patom::types::patomic_int g_sector;
 extern int g_sectorForTrackUpdate;
 extern patom::types::patomic_int g_sectorSending;
+extern patom::types::patomic_int g_prefetchSector;
 extern int g_sledMoveDirection;
 extern uint64_t g_sledTimer;
 extern patom::types::patomic_bool g_soctEnabled;
 extern bool g_subqDelay;
+extern patom::types::patomic_bool g_discLoading;
+extern patom::types::patomic_bool g_subqBusy;
 extern int g_targetPlaybackSpeed;
+extern patom::types::patomic_int g_playbackSpeed;
 extern uint g_audioCtrlMode;
-// extern volatile int32_t g_audioPeak;
-// extern volatile int32_t g_audioLevel;
+extern volatile int32_t g_audioPeak;
+extern volatile int32_t g_audioLevel;
+extern volatile uint32_t g_audioPeakResets;
 
 [[noreturn]] void core0Entry();  // Reset, playback speed, Sled, soct, subq
 [[noreturn]] void core1Entry();  // I2S, sdcard, psnee
 
 void initHW();
 void updatePlaybackSpeed();
-void maybeReset();
+bool maybeReset(uint64_t *deadline);
 }  // namespace picostation
\ No newline at end of file
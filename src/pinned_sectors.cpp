@@ -0,0 +1,157 @@
+#include "pinned_sectors.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "disc_image.h"
+#include "logging.h"
+#include "pico/stdlib.h"
+#include "utils.h"
+#include "values.h"
+
+#if DEBUG_CUE
+#define DEBUG_PRINT(...) printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINT(...) while (0)
+#endif
+
+static constexpr int c_pvdLba = 16;
+
+static uint32_t readLE32(const uint8_t *data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+void picostation::PinnedSectors::load(const TCHAR *cuePath, DiscImage *discImage) {
+    replaceExtension(cuePath, ".pin", m_path, sizeof(m_path));
+
+    m_count = 0;
+    m_candidateCount = 0;
+    m_dirty = false;
+    m_lastSave = time_us_64();
+
+    loadDefaults(discImage);
+    FIL file;
+    if (f_open(&file, m_path, FA_READ) == FR_OK) {
+        char line[16];
+        while (m_count < c_maxPinned && f_gets(line, sizeof(line), &file)) {
+            if (line[0] >= '0' && line[0] <= '9') {
+                add(strtol(line, nullptr, 10));
+            }
+        }
+        f_close(&file);
+    }
+    DEBUG_PRINT("%s: %d pinned sectors\n", m_path, m_count);
+}
+
+void picostation::PinnedSectors::add(const int lba) {
+    for (int i = 0; i < m_count; i++) {
+        if (m_lbas[i] == lba) {
+            return;
+        }
+    }
+    if (m_count < c_maxPinned) {
+        m_lbas[m_count++] = lba;
+    }
+}
+
+// Primary volume descriptor, the first path table sector and the start of the root directory
+void picostation::PinnedSectors::loadDefaults(DiscImage *discImage) {
+    static uint8_t sector[c_cdSamplesBytes];
+    discImage->readData(sector, c_pvdLba);
+    const uint8_t mode = sector[15];
+    const uint8_t *pvd = sector + (mode == 2 ? 24 : 16);
+    if ((mode != 1 && mode != 2) || pvd[0] != 1 || memcmp(pvd + 1, "CD001", 5) != 0) {
+        return;
+    }
+    add(c_pvdLba);
+    add(readLE32(pvd + 140));  // Type L path table
+    const int rootLba = readLE32(pvd + 156 + 2);
+    const int rootSectors = (readLE32(pvd + 156 + 10) + 2047) / 2048;
+    for (int i = 0; i < rootSectors && m_count < c_maxPinned; i++) {
+        add(rootLba + i);
+    }
+}
+
+// Space-saving: a new sector takes over the least counted candidate and inherits its count, so sectors that
+// keep coming back always rise above the ones seen once
+void __time_critical_func(picostation::PinnedSectors::record)(const int lba) {
+    int minIndex = 0;
+    for (int i = 0; i < m_candidateCount; i++) {
+        if (m_candidates[i].lba == lba) {
+            m_candidates[i].count++;
+            m_dirty = true;
+            return;
+        }
+        if (m_candidates[i].count < m_candidates[minIndex].count) {
+            minIndex = i;
+        }
+    }
+    if (m_candidateCount < c_candidates) {
+        m_candidates[m_candidateCount++] = {lba, 1, 0};
+    } else {
+        Candidate &candidate = m_candidates[minIndex];
+        candidate.lba = lba;
+        candidate.error = candidate.count;
+        candidate.count++;
+    }
+    m_dirty = true;
+}
+
+// The c_maxPinned most counted candidates that are certain to have been read c_minCount times
+int picostation::PinnedSectors::learned(int *lbas) const {
+    bool taken[c_candidates] = {};
+    int count = 0;
+    while (count < c_maxPinned) {
+        int best = -1;
+        for (int i = 0; i < m_candidateCount; i++) {
+            const uint32_t count = m_candidates[i].count - m_candidates[i].error;
+            if (!taken[i] && count >= c_minCount &&
+                (best < 0 || count > m_candidates[best].count - m_candidates[best].error)) {
+                best = i;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        taken[best] = true;
+        lbas[count++] = m_candidates[best].lba;
+    }
+    return count;
+}
+
+void picostation::PinnedSectors::maybeSave() {
+    if ((time_us_64() - m_lastSave) >= c_saveIntervalUs) {
+        save();
+    }
+}
+
+void picostation::PinnedSectors::save() {
+    if (!m_dirty) {
+        return;
+    }
+    m_dirty = false;
+    m_lastSave = time_us_64();
+
+    int lbas[c_maxPinned];
+    const int learnedCount = learned(lbas);
+    const int loadedCount = m_count;
+    for (int i = 0; i < learnedCount; i++) {
+        add(lbas[i]);
+    }
+    if (m_count == loadedCount) {
+        return;
+    }
+
+    FIL file;
+    FRESULT fr = f_open(&file, m_path, FA_WRITE | FA_CREATE_ALWAYS);
+    if (fr != FR_OK) {
+        DEBUG_PRINT("%s: f_open error (%d)\n", m_path, fr);
+        return;
+    }
+    for (int i = 0; i < m_count; i++) {
+        f_printf(&file, "%d\n", m_lbas[i]);
+    }
+    f_close(&file);
+    DEBUG_PRINT("%s: saved %d pinned sectors\n", m_path, m_count);
+}
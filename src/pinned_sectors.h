@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ff.h"
+#include "sector_cache.h"
+
+namespace picostation {
+class DiscImage;
+
+// Sectors the console keeps coming back to: the volume descriptor, path table, root directory and whatever
+// play shows to be re-read. Learned with a space-saving top-k count of the sectors the cache gave up and missed
+// again outside a stream, kept in a .pin file next to the cue sheet (one LBA per line) and pinned at load.
+class PinnedSectors {
+  public:
+    static constexpr int c_maxPinned = SectorCache::c_pinnedSlots;
+    static constexpr int c_candidates = 32;
+    static constexpr uint32_t c_minCount = 4;             // Reads before a sector is worth pinning
+    static constexpr uint64_t c_saveIntervalUs = 60000000;  // Rate limit for rewriting the .pin file
+
+    // The ISO 9660 structures of the image, then the .pin file's sectors while there is room
+    void load(const TCHAR *cuePath, DiscImage *discImage);
+    void record(const int lba);  // A sector the cache missed again
+    // Adds the learned sectors the loaded set lacks while there is room and writes the result, at most once per
+    // c_saveIntervalUs. The loaded set is never dropped, delete the .pin file to start over.
+    void maybeSave();
+    void save();  // Now, before another image is loaded
+
+    int count() const { return m_count; }
+    int lba(const int index) const { return m_lbas[index]; }
+
+  private:
+    struct Candidate {
+        int lba;
+        uint32_t count;
+        uint32_t error;  // Inherited from the candidate it replaced, count - error is a lower bound
+    };
+
+    void add(const int lba);
+    void loadDefaults(DiscImage *discImage);
+    int learned(int *lbas) const;
+
+    TCHAR m_path[256];
+    int m_lbas[c_maxPinned];
+    int m_count = 0;
+    Candidate m_candidates[c_candidates];
+    int m_candidateCount = 0;
+    bool m_dirty = false;
+    uint64_t m_lastSave = 0;
+};
+}  // namespace picostation
@@ -0,0 +1,74 @@
+#include "playlist.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include "logging.h"
+#include "utils.h"
+
+#if DEBUG_CUE
+#define DEBUG_PRINT(...) printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINT(...) while (0)
+#endif
+
+static bool isPlaylist(const TCHAR *path) {
+    const char *dot = strrchr(path, '.');
+    return dot && strcasecmp(dot, ".m3u") == 0;
+}
+
+void picostation::Playlist::load(const TCHAR *path) {
+    m_count = 0;
+    char playlistPath[256];
+    if (isPlaylist(path)) {
+        snprintf(playlistPath, sizeof(playlistPath), "%s", path);
+    } else {
+        replaceExtension(path, ".m3u", playlistPath, sizeof(playlistPath));
+    }
+
+    FIL file;
+    if (f_open(&file, playlistPath, FA_READ) != FR_OK) {
+        snprintf(m_paths[0], sizeof(m_paths[0]), "%s", path);
+        m_count = 1;
+        return;
+    }
+
+    // Entries are relative to the playlist, keep its folder with the trailing slash
+    char folder[256];
+    snprintf(folder, sizeof(folder), "%s", playlistPath);
+    char *slash = strrchr(folder, '/');
+    if (slash) {
+        slash[1] = 0;
+    } else {
+        folder[0] = 0;
+    }
+
+    char line[256];
+    while (m_count < c_maxDiscs && f_gets(line, sizeof(line), &file)) {
+        size_t length = strcspn(line, "\r\n");
+        while (length > 0 && line[length - 1] == ' ') {
+            length--;
+        }
+        line[length] = 0;
+        if (length == 0 || line[0] == '#') {
+            continue;
+        }
+        TCHAR *entry = m_paths[m_count];
+        snprintf(entry, sizeof(m_paths[0]), "%s%s", line[0] == '/' ? "" : folder, line);
+        FILINFO info;
+        if (f_stat(entry, &info) != FR_OK) {
+            DEBUG_PRINT("%s: %s not found, skipped\n", playlistPath, entry);
+            continue;
+        }
+        m_count++;
+    }
+    f_close(&file);
+
+    if (m_count == 0) {
+        DEBUG_PRINT("%s: no discs\n", playlistPath);
+        snprintf(m_paths[0], sizeof(m_paths[0]), "%s", path);  // The cue sheet the playlist was found beside
+        m_count = 1;
+    }
+    DEBUG_PRINT("%s: %d discs\n", playlistPath, m_count);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ff.h"
+
+namespace picostation {
+// The discs of a multi-disc game, from an .m3u file: one cue sheet per line, relative to the playlist's folder,
+// blank lines and # comments skipped. A cue sheet with an .m3u of the same name next to it loads that instead,
+// otherwise it is a playlist of that one image.
+class Playlist {
+  public:
+    static constexpr int c_maxDiscs = 8;
+
+    void load(const TCHAR *path);
+
+    int count() const { return m_count; }
+    const TCHAR *path(const int index) const { return m_paths[index]; }
+    int next(const int index) const { return (index + 1) % m_count; }  // Wraps to the first disc
+
+  private:
+    TCHAR m_paths[c_maxDiscs][256];
+    int m_count = 0;
+};
+}  // namespace picostation
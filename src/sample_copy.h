@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <algorithm>
+
+#include "values.h"
+
+namespace picostation {
+// The I2S loop's copy of a sector into the PIO sample buffer. Inline here so tools/host_check can time the same
+// loops the firmware runs.
+namespace samplecopy {
+// 16-bit sample to the 24-bit I2S word, the LSB is repeated into the padding
+static inline uint32_t expand(const uint16_t sample) {
+    uint32_t i2s_data = sample << 8;
+    if (i2s_data & 0x100) {
+        i2s_data |= 0xFF;
+    }
+    return i2s_data;
+}
+
+static inline int32_t absSample(const uint16_t sample) {
+    const int32_t value = (int16_t)sample;
+    return value < 0 ? -value : value;
+}
+
+static inline void copyData(uint32_t *samples, const uint16_t *sector, const uint16_t *scramblingKey) {
+    for (size_t i = 0; i < c_cdSamplesSize * 2; i++) {
+        samples[i] = expand(sector[i] ^ scramblingKey[i]);
+    }
+}
+
+// The audio meters are taken in the same pass, one stereo frame per iteration
+static inline void copyAudio(uint32_t *samples, const uint16_t *sector, int32_t *peakLeft, int32_t *peakRight) {
+    int32_t left = 0;
+    int32_t right = 0;
+    for (size_t i = 0; i < c_cdSamplesSize * 2; i += 2) {
+        samples[i] = expand(sector[i]);
+        samples[i + 1] = expand(sector[i + 1]);
+        left = std::max(left, absSample(sector[i]));
+        right = std::max(right, absSample(sector[i + 1]));
+    }
+    *peakLeft = left;
+    *peakRight = right;
+}
+}  // namespace samplecopy
+}  // namespace picostation
@@ -0,0 +1,160 @@
+#include "sd_clock.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "f_util.h"
+#include "ff.h"
+#include "hardware/clocks.h"
+#include "hardware/spi.h"
+#include "logging.h"
+#include "pico/stdlib.h"
+#include "sdio.h"
+
+#if DEBUG_SD
+#define DEBUG_PRINT(...) printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINT(...) while (0)
+#endif
+
+static constexpr const TCHAR *c_clockFile = "sdclock.txt";
+
+static constexpr uint c_minBaud = 12500 * 1000;  // Always tried, used for the reference reads
+static constexpr uint c_maxBaud = 50 * 1000 * 1000;
+
+static constexpr uint c_testPositions = 8;  // Spread over the card
+static constexpr uint c_testBlocks = 4;     // Per read, so multi-block transfers are exercised
+static constexpr uint c_testPasses = 3;
+
+static uint8_t s_testBuffer[c_testBlocks * 512];
+static uint32_t s_reference[c_testPositions];
+
+// FNV-1a: CRC errors are caught by the driver, this also catches corruption in builds without SD_CRC_ENABLED
+static uint32_t hashBuffer(const uint8_t *data, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static uint64_t testSector(sd_card_t *sdCard, uint position) {
+    return ((sdCard->sectors - c_testBlocks) / c_testPositions) * position;
+}
+
+static uint setBaud(sd_card_t *sdCard, uint baud) {
+    sdCard->spi->baud_rate = spi_set_baudrate(sdCard->spi->hw_inst, baud);
+    return sdCard->spi->baud_rate;
+}
+
+static bool readReference(sd_card_t *sdCard) {
+    for (uint i = 0; i < c_testPositions; i++) {
+        if (sdCard->read_blocks(sdCard, s_testBuffer, testSector(sdCard, i), c_testBlocks) != 0) {
+            return false;
+        }
+        s_reference[i] = hashBuffer(s_testBuffer, sizeof(s_testBuffer));
+    }
+    return true;
+}
+
+// Test reads must not be rescued by the driver's own step-down, so a fallback counts as a failure
+static bool verify(sd_card_t *sdCard) {
+    const uint32_t fallbacks = sdCard->clock_fallbacks;
+    for (uint pass = 0; pass < c_testPasses; pass++) {
+        for (uint i = 0; i < c_testPositions; i++) {
+            if (sdCard->read_blocks(sdCard, s_testBuffer, testSector(sdCard, i), c_testBlocks) != 0 ||
+                sdCard->clock_fallbacks != fallbacks ||
+                hashBuffer(s_testBuffer, sizeof(s_testBuffer)) != s_reference[i]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Failed candidates are expected while tuning, the counters are about play
+static void resetStats(sd_card_t *sdCard) {
+    sdCard->crc_errors = 0;
+    sdCard->clock_fallbacks = 0;
+}
+
+static uint loadBaud() {
+    FIL file;
+    if (f_open(&file, c_clockFile, FA_READ) != FR_OK) {
+        return 0;
+    }
+    char text[16] = {0};
+    UINT br;
+    f_read(&file, text, sizeof(text) - 1, &br);
+    f_close(&file);
+    return strtoul(text, nullptr, 10);
+}
+
+static void saveBaud(uint baud) {
+    FIL file;
+    FRESULT fr = f_open(&file, c_clockFile, FA_WRITE | FA_CREATE_ALWAYS);
+    if (fr != FR_OK) {
+        DEBUG_PRINT("sdclock: f_open error: %s (%d)\n", FRESULT_str(fr), fr);
+        return;
+    }
+    char text[16];
+    const int length = snprintf(text, sizeof(text), "%u\n", baud);
+    UINT bw;
+    f_write(&file, text, length, &bw);
+    f_close(&file);
+}
+
+void picostation::sdclock::tune(sd_card_t *sdCard) {
+    if (sdio::isActive() || sdCard->sectors < c_testBlocks * c_testPositions) {
+        return;
+    }
+
+    const uint mountBaud = sdCard->spi->baud_rate;
+    setBaud(sdCard, c_minBaud);
+    if (!readReference(sdCard)) {
+        setBaud(sdCard, mountBaud);
+        return;
+    }
+
+    const uint stored = loadBaud();
+    if (stored >= c_minBaud && stored <= c_maxBaud) {
+        setBaud(sdCard, stored);
+        if (verify(sdCard)) {
+            DEBUG_PRINT("sdclock: stored %u Hz verified\n", sdCard->spi->baud_rate);
+            resetStats(sdCard);
+            return;
+        }
+        DEBUG_PRINT("sdclock: stored %u Hz failed, retuning\n", stored);
+    }
+
+    // Walk up the SPI dividers (clk_peri / 2n) from c_minBaud and keep the last rate that passes
+    const uint peripheralHz = clock_get_hz(clk_peri);
+    uint best = setBaud(sdCard, c_minBaud);
+    for (uint divider = peripheralHz / (2 * c_minBaud); divider >= 1; divider--) {
+        const uint candidate = peripheralHz / (2 * divider);
+        if (candidate <= best) {
+            continue;
+        }
+        if (candidate > c_maxBaud) {
+            break;
+        }
+        setBaud(sdCard, candidate);
+        if (!verify(sdCard)) {
+            DEBUG_PRINT("sdclock: %u Hz failed\n", sdCard->spi->baud_rate);
+            break;
+        }
+        best = sdCard->spi->baud_rate;
+    }
+
+    setBaud(sdCard, best);
+    resetStats(sdCard);
+    DEBUG_PRINT("sdclock: tuned to %u Hz\n", best);
+    if (best != stored) {
+        saveBaud(best);
+    }
+}
+
+picostation::sdclock::Stats picostation::sdclock::getStats(sd_card_t *sdCard) {
+    return {sdio::isActive() ? 0 : sdCard->spi->baud_rate, sdCard->crc_errors, sdCard->clock_fallbacks};
+}
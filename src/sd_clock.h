@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "sd_card.h"
+
+namespace picostation {
+namespace sdclock {
+struct Stats {
+    uint baudRate;
+    uint32_t crcErrors;       // Data CRC errors seen by reads since mount
+    uint32_t clockFallbacks;  // Clock step-downs caused by them
+};
+
+// Finds the fastest SPI clock that passes CRC-checked test reads on this card and keeps it in c_clockFile on
+// the card, so later mounts only verify the stored rate. Call after the volume is mounted.
+void tune(sd_card_t *sdCard);
+Stats getStats(sd_card_t *sdCard);
+}  // namespace sdclock
+}  // namespace picostation
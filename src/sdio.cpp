@@ -0,0 +1,648 @@
+#include "sdio.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "crc.h"
+#include "diskio.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/pio.h"
+#include "logging.h"
+#include "pico/stdlib.h"
+#include "sdio.pio.h"
+
+#if DEBUG_SD
+#define DEBUG_PRINT(...) printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINT(...) while (0)
+#endif
+
+namespace Response {
+enum : uint { NONE, R1, R1B, R2, R3, R6, R7 };
+}
+
+static constexpr uint c_blockSize = 512;
+static constexpr uint c_blockWords = c_blockSize / sizeof(uint32_t);
+static constexpr uint c_rxNibbles = c_blockSize * 2 + 16;         // Data + CRC16 of each line
+static constexpr uint c_txNibbles = 8 + c_blockSize * 2 + 16 + 1;  // Idle + start, data, CRC, end
+static constexpr uint c_identificationBaud = 400 * 1000;
+static constexpr uint32_t c_statusErrorMask = 0xfdf80000;  // R1 error bits, CARD_IS_LOCKED excluded
+
+static constexpr uint32_t c_commandTimeoutMs = 10;
+static constexpr uint32_t c_readTimeoutMs = 250;
+static constexpr uint32_t c_busyTimeoutMs = 500;
+static constexpr uint32_t c_initTimeoutMs = 1000;
+
+static const picostation::sdio::Config *s_config;
+static bool s_active = false;
+
+// SPI hooks installed by sd_init_driver(), restored if the card does not come up on the 4-bit bus
+static int (*s_spiInit)(sd_card_t *sdCard);
+static int (*s_spiReadBlocks)(sd_card_t *sdCard, uint8_t *buffer, uint64_t sector, uint32_t count);
+static int (*s_spiWriteBlocks)(sd_card_t *sdCard, const uint8_t *buffer, uint64_t sector, uint32_t count);
+static bool (*s_spiTestCom)(sd_card_t *sdCard);
+
+static int s_smCmd = -1;
+static int s_smRx = -1;
+static int s_smTx = -1;
+static int s_offsetCmd = -1;
+static int s_offsetRx = -1;
+static int s_offsetTx = -1;
+static int s_dmaData = -1;
+static int s_dmaCrc = -1;
+
+static uint s_clockHz;
+static uint32_t s_rca;
+static bool s_blockAddressed;
+
+// Bounce buffers for FatFs buffers that are not word aligned, and the CRC words of the block in flight
+static uint32_t s_bounce[2][c_blockWords];
+static uint32_t s_rxCrc[2][2];
+
+// CRC16 of each data line, computed in parallel: the four line registers are interleaved nibble-wise in a
+// 64-bit accumulator, so one 32-bit word of bus data (eight clocks, first nibble in the MSBs) is consumed at
+// a time. The x^12 tap reaches the top of the register again four clocks later, hence the >> 16.
+static uint64_t __time_critical_func(crc16x4)(const uint8_t *data, uint length) {
+    uint64_t crc = 0;
+    for (uint i = 0; i < length; i += 4) {
+        const uint32_t in = (data[i] << 24) | (data[i + 1] << 16) | (data[i + 2] << 8) | data[i + 3];
+        uint32_t feedback = (uint32_t)(crc >> 32) ^ in;
+        feedback ^= feedback >> 16;
+        crc = (crc << 32) ^ feedback ^ ((uint64_t)feedback << 20) ^ ((uint64_t)feedback << 48);
+    }
+    return crc;
+}
+
+static void setClock(uint hz) {
+    const uint sysHz = clock_get_hz(clk_sys);
+    uint divider = (sysHz + (2 * hz) - 1) / (2 * hz);  // Two instructions per CLK period
+    if (divider < 1) {
+        divider = 1;
+    }
+    pio_sm_set_clkdiv_int_frac(s_config->pio, s_smCmd, divider, 0);
+    s_clockHz = sysHz / (2 * divider);
+}
+
+static void resetCommandSM() {
+    PIO pio = s_config->pio;
+    pio_sm_set_enabled(pio, s_smCmd, false);
+    pio_sm_clear_fifos(pio, s_smCmd);
+    pio_sm_restart(pio, s_smCmd);
+    pio_sm_exec(pio, s_smCmd, pio_encode_set(pio_pindirs, 0));
+    pio_sm_exec(pio, s_smCmd, pio_encode_jmp(s_offsetCmd));
+    pio_sm_set_enabled(pio, s_smCmd, true);
+}
+
+static int waitNotBusy() {
+    // Busy starts up to two clocks after the response end bit
+    busy_wait_us_32((4 * 1000 * 1000) / s_clockHz + 1);
+
+    const absolute_time_t timeout = make_timeout_time_ms(c_busyTimeoutMs);
+    while (!gpio_get(s_config->d0Gpio)) {
+        if (time_reached(timeout)) {
+            DEBUG_PRINT("sdio: busy timeout\n");
+            return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+        }
+    }
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+// R2 results are returned as the 128-bit CID/CSD register in four words, most significant first
+static int sendCommand(uint command, uint32_t argument, uint response, uint32_t *result) {
+    PIO pio = s_config->pio;
+
+    const uint8_t frame[5] = {(uint8_t)(0x40 | command), (uint8_t)(argument >> 24), (uint8_t)(argument >> 16),
+                              (uint8_t)(argument >> 8), (uint8_t)argument};
+    const uint8_t crc = crc7((const char *)frame, sizeof(frame));
+    const uint32_t responseBits = (response == Response::NONE) ? 0 : (response == Response::R2) ? 134 : 46;
+
+    pio_sm_put_blocking(pio, s_smCmd, (47u << 24) | (responseBits << 16) | (frame[0] << 8) | frame[1]);
+    pio_sm_put_blocking(pio, s_smCmd, (frame[2] << 24) | (frame[3] << 16) | (frame[4] << 8) | (crc << 1) | 1);
+
+    if (response == Response::NONE) {
+        return SD_BLOCK_DEVICE_ERROR_NONE;
+    }
+
+    uint32_t raw[5];
+    const uint words = (response == Response::R2) ? 5 : 2;
+    const absolute_time_t timeout = make_timeout_time_ms(c_commandTimeoutMs);
+    for (uint i = 0; i < words; i++) {
+        while (pio_sm_is_rx_fifo_empty(pio, s_smCmd)) {
+            if (time_reached(timeout)) {
+                DEBUG_PRINT("sdio: CMD%u no response\n", command);
+                resetCommandSM();
+                return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+            }
+        }
+        raw[i] = pio_sm_get(pio, s_smCmd);
+    }
+
+    if (response == Response::R2) {
+        // 135 bits after the start bit, the register starts after the 7-bit header
+        result[0] = (raw[0] << 7) | (raw[1] >> 25);
+        result[1] = (raw[1] << 7) | (raw[2] >> 25);
+        result[2] = (raw[2] << 7) | (raw[3] >> 25);
+        result[3] = (raw[3] << 7) | (raw[4] & 0x7f);
+        return SD_BLOCK_DEVICE_ERROR_NONE;
+    }
+
+    // Bits 46..0 of the response: transmission bit, index, 32-bit payload, CRC7, end bit
+    const uint64_t bits = ((uint64_t)raw[0] << 15) | (raw[1] & 0x7fff);
+    const uint32_t payload = (uint32_t)(bits >> 8);
+
+    if (response != Response::R3) {  // R3 carries no CRC and no index
+        const uint8_t check[5] = {(uint8_t)((bits >> 40) & 0x7f), (uint8_t)(payload >> 24), (uint8_t)(payload >> 16),
+                                  (uint8_t)(payload >> 8), (uint8_t)payload};
+        if (((bits >> 40) & 0x3f) != command || crc7((const char *)check, sizeof(check)) != ((bits >> 1) & 0x7f)) {
+            DEBUG_PRINT("sdio: CMD%u response CRC error\n", command);
+            return SD_BLOCK_DEVICE_ERROR_CRC;
+        }
+    }
+
+    *result = payload;
+
+    if ((response == Response::R1 || response == Response::R1B) && command != 12 &&
+        (payload & c_statusErrorMask)) {
+        DEBUG_PRINT("sdio: CMD%u status %08lx\n", command, payload);
+        return SD_BLOCK_DEVICE_ERROR_UNUSABLE;
+    }
+
+    if (response == Response::R1B) {
+        return waitNotBusy();
+    }
+
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+// Loads a value < 2^15 into the Y register of a stopped state machine
+static void loadY(PIO pio, uint sm, uint32_t value) {
+    pio_sm_exec(pio, sm, pio_encode_mov(pio_isr, pio_null));
+    for (int shift = 10; shift >= 0; shift -= 5) {
+        pio_sm_exec(pio, sm, pio_encode_set(pio_y, (value >> shift) & 0x1f));
+        pio_sm_exec(pio, sm, pio_encode_in(pio_y, 5));
+    }
+    pio_sm_exec(pio, sm, pio_encode_mov(pio_y, pio_isr));
+    pio_sm_exec(pio, sm, pio_encode_mov(pio_isr, pio_null));
+}
+
+static void startReceiver() {
+    PIO pio = s_config->pio;
+    pio_sm_set_enabled(pio, s_smRx, false);
+    pio_sm_clear_fifos(pio, s_smRx);
+    pio_sm_restart(pio, s_smRx);
+    loadY(pio, s_smRx, c_rxNibbles - 1);
+    pio_sm_exec(pio, s_smRx, pio_encode_jmp(s_offsetRx));
+    pio_sm_set_enabled(pio, s_smRx, true);
+}
+
+static void stopReceiver() {
+    PIO pio = s_config->pio;
+    dma_channel_abort(s_dmaData);
+    dma_channel_abort(s_dmaCrc);
+    pio_sm_set_enabled(pio, s_smRx, false);
+    pio_sm_clear_fifos(pio, s_smRx);
+}
+
+// Data words go to the buffer (byte swapped: the bus is big-endian), the two CRC words to crc
+static void __time_critical_func(armReceive)(uint8_t *buffer, uint32_t *crc) {
+    PIO pio = s_config->pio;
+    const uint dreq = pio_get_dreq(pio, s_smRx, false);
+
+    dma_channel_config c = dma_channel_get_default_config(s_dmaCrc);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, dreq);
+    dma_channel_configure(s_dmaCrc, &c, crc, &pio->rxf[s_smRx], 2, false);
+
+    c = dma_channel_get_default_config(s_dmaData);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, dreq);
+    channel_config_set_bswap(&c, true);
+    channel_config_set_chain_to(&c, s_dmaCrc);
+    dma_channel_configure(s_dmaData, &c, buffer, &pio->rxf[s_smRx], c_blockWords, true);
+}
+
+static int __time_critical_func(waitReceive)(const uint32_t *crc) {
+    const absolute_time_t timeout = make_timeout_time_ms(c_readTimeoutMs);
+    while (dma_hw->ch[s_dmaCrc].write_addr != (uintptr_t)(crc + 2)) {
+        if (time_reached(timeout)) {
+            DEBUG_PRINT("sdio: read timeout\n");
+            return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+        }
+    }
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+static int __time_critical_func(readBlocks)(sd_card_t *sdCard, uint8_t *buffer, uint64_t sector, uint32_t count) {
+    if (sdCard->m_Status & STA_NOINIT) {
+        return SD_BLOCK_DEVICE_ERROR_NO_INIT;
+    }
+    if (count == 0 || sector + count > sdCard->sectors) {
+        return SD_BLOCK_DEVICE_ERROR_PARAMETER;
+    }
+
+    const bool aligned = ((uintptr_t)buffer & 3) == 0;
+    const uint32_t address = s_blockAddressed ? (uint32_t)sector : (uint32_t)(sector * c_blockSize);
+
+    startReceiver();
+    armReceive(aligned ? buffer : (uint8_t *)s_bounce[0], s_rxCrc[0]);
+
+    uint32_t status;
+    int rc = sendCommand(count > 1 ? 18 : 17, address, Response::R1, &status);
+
+    for (uint32_t block = 0; rc == SD_BLOCK_DEVICE_ERROR_NONE && block < count; block++) {
+        const uint slot = block & 1;
+        uint8_t *received = aligned ? buffer : (uint8_t *)s_bounce[slot];
+
+        rc = waitReceive(s_rxCrc[slot]);
+        if (rc != SD_BLOCK_DEVICE_ERROR_NONE) {
+            break;
+        }
+
+        // Rearm first: the card does not wait, and the RX FIFO only covers a few clocks
+        if (block + 1 < count) {
+            armReceive(aligned ? buffer + c_blockSize : (uint8_t *)s_bounce[slot ^ 1], s_rxCrc[slot ^ 1]);
+        }
+
+        const uint64_t crc = ((uint64_t)s_rxCrc[slot][0] << 32) | s_rxCrc[slot][1];
+        if (crc16x4(received, c_blockSize) != crc) {
+            DEBUG_PRINT("sdio: data CRC error, sector %llu\n", sector + block);
+            sdCard->crc_errors++;
+            rc = SD_BLOCK_DEVICE_ERROR_CRC;
+            break;
+        }
+
+        if (!aligned) {
+            memcpy(buffer, received, c_blockSize);
+        }
+        buffer += c_blockSize;
+    }
+
+    if (count > 1) {
+        const int stopRc = sendCommand(12, 0, Response::R1B, &status);
+        if (rc == SD_BLOCK_DEVICE_ERROR_NONE) {
+            rc = stopRc;
+        }
+    }
+    stopReceiver();
+
+    return rc;
+}
+
+static int waitTransferState() {
+    const absolute_time_t timeout = make_timeout_time_ms(c_busyTimeoutMs);
+    uint32_t status;
+    while (true) {
+        const int rc = sendCommand(13, s_rca << 16, Response::R1, &status);
+        if (rc != SD_BLOCK_DEVICE_ERROR_NONE) {
+            return rc;
+        }
+        if (((status >> 9) & 0xf) == 4) {  // tran
+            return SD_BLOCK_DEVICE_ERROR_NONE;
+        }
+        if (time_reached(timeout)) {
+            DEBUG_PRINT("sdio: write timeout\n");
+            return SD_BLOCK_DEVICE_ERROR_WRITE;
+        }
+    }
+}
+
+static int writeBlocks(sd_card_t *sdCard, const uint8_t *buffer, uint64_t sector, uint32_t count) {
+    if (sdCard->m_Status & STA_NOINIT) {
+        return SD_BLOCK_DEVICE_ERROR_NO_INIT;
+    }
+    if (count == 0 || sector + count > sdCard->sectors) {
+        return SD_BLOCK_DEVICE_ERROR_PARAMETER;
+    }
+
+    PIO pio = s_config->pio;
+    const uint32_t dataPins = 0xfu << s_config->d0Gpio;
+
+    // FatFs writes are rare here (no streaming), so blocks go out one CMD24 at a time
+    for (uint32_t block = 0; block < count; block++, sector++, buffer += c_blockSize) {
+        const uint8_t *source = buffer;
+        if ((uintptr_t)buffer & 3) {
+            memcpy(s_bounce[0], buffer, c_blockSize);
+            source = (const uint8_t *)s_bounce[0];
+        }
+        const uint64_t crc = crc16x4(source, c_blockSize);
+
+        uint32_t status;
+        const uint32_t address = s_blockAddressed ? (uint32_t)sector : (uint32_t)(sector * c_blockSize);
+        int rc = sendCommand(24, address, Response::R1, &status);
+        if (rc != SD_BLOCK_DEVICE_ERROR_NONE) {
+            return rc;
+        }
+
+        pio_sm_set_enabled(pio, s_smTx, false);
+        pio_sm_clear_fifos(pio, s_smTx);
+        pio_sm_restart(pio, s_smTx);
+        pio_sm_set_pins_with_mask(pio, s_smTx, dataPins, dataPins);
+        pio_sm_set_pindirs_with_mask(pio, s_smTx, dataPins, dataPins);
+        pio_sm_exec(pio, s_smTx, pio_encode_jmp(s_offsetTx));
+        pio_sm_set_enabled(pio, s_smTx, true);
+
+        pio_sm_put_blocking(pio, s_smTx, c_txNibbles - 1);
+        pio_sm_put_blocking(pio, s_smTx, 0xfffffff0);  // Idle, start nibble
+
+        dma_channel_config c = dma_channel_get_default_config(s_dmaData);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+        channel_config_set_read_increment(&c, true);
+        channel_config_set_write_increment(&c, false);
+        channel_config_set_dreq(&c, pio_get_dreq(pio, s_smTx, true));
+        channel_config_set_bswap(&c, true);
+        dma_channel_configure(s_dmaData, &c, &pio->txf[s_smTx], source, c_blockWords, true);
+        dma_channel_wait_for_finish_blocking(s_dmaData);
+
+        pio_sm_put_blocking(pio, s_smTx, (uint32_t)(crc >> 32));
+        pio_sm_put_blocking(pio, s_smTx, (uint32_t)crc);
+        pio_sm_put_blocking(pio, s_smTx, 0xf0000000);  // End nibble, then release the lines
+
+        // The SM stalls on the next pull once the end nibble is out
+        const uint32_t stallMask = 1u << (PIO_FDEBUG_TXSTALL_LSB + s_smTx);
+        pio->fdebug = stallMask;
+        const absolute_time_t timeout = make_timeout_time_ms(c_commandTimeoutMs);
+        while (!(pio->fdebug & stallMask) && !time_reached(timeout)) {
+            tight_loop_contents();
+        }
+        pio_sm_set_enabled(pio, s_smTx, false);
+        pio_sm_set_pindirs_with_mask(pio, s_smTx, 0, dataPins);
+
+        rc = waitTransferState();
+        if (rc != SD_BLOCK_DEVICE_ERROR_NONE) {
+            return rc;
+        }
+    }
+
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+// The card does one thing at a time, so the hooks take its mutex like the SPI driver's do. Trace, pinned sector
+// and verifier writes can come from elsewhere than the sector reads.
+static int __time_critical_func(sdioReadBlocks)(sd_card_t *sdCard, uint8_t *buffer, uint64_t sector,
+                                                uint32_t count) {
+    mutex_enter_blocking(&sdCard->mutex);
+    const int rc = readBlocks(sdCard, buffer, sector, count);
+    mutex_exit(&sdCard->mutex);
+    return rc;
+}
+
+static int sdioWriteBlocks(sd_card_t *sdCard, const uint8_t *buffer, uint64_t sector, uint32_t count) {
+    mutex_enter_blocking(&sdCard->mutex);
+    const int rc = writeBlocks(sdCard, buffer, sector, count);
+    mutex_exit(&sdCard->mutex);
+    return rc;
+}
+
+static bool sdioTestCom(sd_card_t *sdCard) {
+    if (!mutex_is_initialized(&sdCard->mutex)) {
+        mutex_init(&sdCard->mutex);  // May be called before init, as with the SPI driver
+    }
+    mutex_enter_blocking(&sdCard->mutex);
+    uint32_t status;
+    const bool ok = sendCommand(13, s_rca << 16, Response::R1, &status) == SD_BLOCK_DEVICE_ERROR_NONE;
+    mutex_exit(&sdCard->mutex);
+    return ok;
+}
+
+static uint64_t csdSectors(const uint32_t *csd) {
+    if ((csd[0] >> 30) == 1) {  // CSD 2.0: C_SIZE [69:48], 512 KiB units
+        const uint32_t cSize = ((csd[1] & 0x3f) << 16) | (csd[2] >> 16);
+        return (uint64_t)(cSize + 1) * 1024;
+    }
+
+    // CSD 1.0: C_SIZE [73:62], C_SIZE_MULT [49:47], READ_BL_LEN [83:80]
+    const uint32_t cSize = ((csd[1] & 0x3ff) << 2) | (csd[2] >> 30);
+    const uint32_t cSizeMult = (csd[2] >> 15) & 0x7;
+    const uint32_t readBlockLength = (csd[1] >> 16) & 0xf;
+    const uint64_t bytes = (uint64_t)(cSize + 1) << (cSizeMult + 2 + readBlockLength);
+    return bytes / c_blockSize;
+}
+
+static int cardInit(sd_card_t *sdCard) {
+    uint32_t response;
+    uint32_t reg[4];
+
+    sleep_ms(1);  // At least 74 clocks at identification speed before the first command
+
+    sendCommand(0, 0, Response::NONE, nullptr);
+
+    const bool v2 = sendCommand(8, 0x1aa, Response::R7, &response) == SD_BLOCK_DEVICE_ERROR_NONE;
+    if (v2 && (response & 0xfff) != 0x1aa) {
+        return SD_BLOCK_DEVICE_ERROR_UNUSABLE;
+    }
+
+    uint32_t ocr = 0;
+    const absolute_time_t timeout = make_timeout_time_ms(c_initTimeoutMs);
+    while (!(ocr & 0x80000000)) {
+        int rc = sendCommand(55, 0, Response::R1, &response);
+        if (rc == SD_BLOCK_DEVICE_ERROR_NONE) {
+            rc = sendCommand(41, (v2 ? 0x40000000 : 0) | 0x00ff8000, Response::R3, &ocr);
+        }
+        if (rc != SD_BLOCK_DEVICE_ERROR_NONE) {
+            return rc;
+        }
+        if (time_reached(timeout)) {
+            return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+        }
+    }
+    s_blockAddressed = ocr & 0x40000000;
+
+    int rc = sendCommand(2, 0, Response::R2, reg);
+    if (rc == SD_BLOCK_DEVICE_ERROR_NONE) {
+        rc = sendCommand(3, 0, Response::R6, &response);
+        s_rca = response >> 16;
+    }
+    if (rc == SD_BLOCK_DEVICE_ERROR_NONE) {
+        rc = sendCommand(9, s_rca << 16, Response::R2, reg);
+        sdCard->sectors = csdSectors(reg);
+    }
+    if (rc == SD_BLOCK_DEVICE_ERROR_NONE) {
+        rc = sendCommand(7, s_rca << 16, Response::R1B, &response);
+    }
+    if (rc == SD_BLOCK_DEVICE_ERROR_NONE) {
+        rc = sendCommand(55, s_rca << 16, Response::R1, &response);
+    }
+    if (rc == SD_BLOCK_DEVICE_ERROR_NONE) {
+        rc = sendCommand(6, 2, Response::R1, &response);  // ACMD6: 4-bit bus
+    }
+    if (rc == SD_BLOCK_DEVICE_ERROR_NONE && !s_blockAddressed) {
+        rc = sendCommand(16, c_blockSize, Response::R1, &response);
+    }
+    if (rc != SD_BLOCK_DEVICE_ERROR_NONE) {
+        return rc;
+    }
+
+    setClock(s_config->baudRate);
+
+    // Prove all four lines at full speed: the CRC of each line is checked. sdioInit holds the mutex already.
+    sdCard->m_Status &= ~STA_NOINIT;
+    rc = readBlocks(sdCard, (uint8_t *)s_bounce[1], 0, 1);
+    if (rc != SD_BLOCK_DEVICE_ERROR_NONE) {
+        sdCard->m_Status |= STA_NOINIT;
+        return rc;
+    }
+
+    DEBUG_PRINT("sdio: %llu sectors, %u Hz\n", sdCard->sectors, s_clockHz);
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+// The wait instructions of the data programs watch CLK, which is not part of their pin mapping
+static int addProgram(PIO pio, const pio_program_t *program, uint clkGpio) {
+    uint16_t instructions[32];
+    for (uint i = 0; i < program->length; i++) {
+        uint16_t instruction = program->instructions[i];
+        if ((instruction & 0xe060) == 0x2000) {  // WAIT GPIO
+            instruction = (instruction & ~0x1f) | clkGpio;
+        }
+        instructions[i] = instruction;
+    }
+
+    pio_program_t patched = *program;
+    patched.instructions = instructions;
+    if (!pio_can_add_program(pio, &patched)) {
+        return -1;
+    }
+    return pio_add_program(pio, &patched);
+}
+
+static void releaseResources() {
+    PIO pio = s_config->pio;
+
+    if (s_smCmd >= 0) {
+        pio_sm_set_enabled(pio, s_smCmd, false);
+        pio_sm_unclaim(pio, s_smCmd);
+    }
+    if (s_smRx >= 0) {
+        pio_sm_set_enabled(pio, s_smRx, false);
+        pio_sm_unclaim(pio, s_smRx);
+    }
+    if (s_smTx >= 0) {
+        pio_sm_set_enabled(pio, s_smTx, false);
+        pio_sm_unclaim(pio, s_smTx);
+    }
+    if (s_offsetCmd >= 0) {
+        pio_remove_program(pio, &sdio_cmd_clk_program, s_offsetCmd);
+    }
+    if (s_offsetRx >= 0) {
+        pio_remove_program(pio, &sdio_data_rx_program, s_offsetRx);
+    }
+    if (s_offsetTx >= 0) {
+        pio_remove_program(pio, &sdio_data_tx_program, s_offsetTx);
+    }
+    if (s_dmaData >= 0) {
+        dma_channel_unclaim(s_dmaData);
+    }
+    if (s_dmaCrc >= 0) {
+        dma_channel_unclaim(s_dmaCrc);
+    }
+
+    s_smCmd = s_smRx = s_smTx = -1;
+    s_offsetCmd = s_offsetRx = s_offsetTx = -1;
+    s_dmaData = s_dmaCrc = -1;
+}
+
+static bool claimResources() {
+    const picostation::sdio::Config &config = *s_config;
+    PIO pio = config.pio;
+
+    s_smCmd = pio_claim_unused_sm(pio, false);
+    s_smRx = pio_claim_unused_sm(pio, false);
+    s_smTx = pio_claim_unused_sm(pio, false);
+    s_offsetCmd = pio_can_add_program(pio, &sdio_cmd_clk_program) ? pio_add_program(pio, &sdio_cmd_clk_program) : -1;
+    s_offsetRx = addProgram(pio, &sdio_data_rx_program, config.clkGpio);
+    s_offsetTx = addProgram(pio, &sdio_data_tx_program, config.clkGpio);
+    s_dmaData = dma_claim_unused_channel(false);
+    s_dmaCrc = dma_claim_unused_channel(false);
+
+    if (s_smCmd < 0 || s_smRx < 0 || s_smTx < 0 || s_offsetCmd < 0 || s_offsetRx < 0 || s_offsetTx < 0 ||
+        s_dmaData < 0 || s_dmaCrc < 0) {
+        DEBUG_PRINT("sdio: out of PIO/DMA resources\n");
+        return false;
+    }
+
+    for (uint i = 0; i < 4; i++) {
+        pio_gpio_init(pio, config.d0Gpio + i);
+        gpio_pull_up(config.d0Gpio + i);
+    }
+
+    sdio_data_rx_program_init(pio, s_smRx, s_offsetRx, config.d0Gpio);
+    sdio_data_tx_program_init(pio, s_smTx, s_offsetTx, config.d0Gpio);
+    pio_sm_set_consecutive_pindirs(pio, s_smRx, config.d0Gpio, 4, false);
+
+    sdio_cmd_clk_program_init(pio, s_smCmd, s_offsetCmd, config.clkGpio, config.cmdGpio, 1);
+    setClock(c_identificationBaud);
+    pio_sm_set_enabled(pio, s_smCmd, true);
+
+    return true;
+}
+
+static void restoreSPI(sd_card_t *sdCard) {
+    sdCard->init = s_spiInit;
+    sdCard->read_blocks = s_spiReadBlocks;
+    sdCard->write_blocks = s_spiWriteBlocks;
+    sdCard->sd_test_com = s_spiTestCom;
+
+    // The bus lines may be shared with the SPI wiring
+    spi_t *spi = sdCard->spi;
+    gpio_set_function(spi->miso_gpio, GPIO_FUNC_SPI);
+    gpio_set_function(spi->mosi_gpio, GPIO_FUNC_SPI);
+    gpio_set_function(spi->sck_gpio, GPIO_FUNC_SPI);
+    gpio_init(sdCard->ss_gpio);
+    gpio_put(sdCard->ss_gpio, 1);
+    gpio_set_dir(sdCard->ss_gpio, GPIO_OUT);
+}
+
+static int sdioInit(sd_card_t *sdCard) {
+    if (!mutex_is_initialized(&sdCard->mutex)) {
+        mutex_init(&sdCard->mutex);  // The SPI init that would have done it may never run
+    }
+    mutex_enter_blocking(&sdCard->mutex);
+    if (!(sdCard->m_Status & STA_NOINIT)) {
+        mutex_exit(&sdCard->mutex);
+        return sdCard->m_Status;
+    }
+
+    // A remount starts over from the identification clock
+    releaseResources();
+    s_active = false;
+    if (claimResources()) {
+        const int rc = cardInit(sdCard);
+        if (rc == SD_BLOCK_DEVICE_ERROR_NONE) {
+            s_active = true;
+            mutex_exit(&sdCard->mutex);
+            return sdCard->m_Status;
+        }
+        DEBUG_PRINT("sdio: init failed (%d), falling back to SPI\n", rc);
+    }
+
+    releaseResources();
+    restoreSPI(sdCard);
+    mutex_exit(&sdCard->mutex);  // The SPI init takes it itself
+    return sdCard->init(sdCard);
+}
+
+void picostation::sdio::attach(sd_card_t *sdCard, const Config *config) {
+    s_config = config;
+    if (sdCard->init == sdioInit) {
+        return;  // Attached by an earlier mount, the saved hooks are still the SPI ones
+    }
+
+    s_spiInit = sdCard->init;
+    s_spiReadBlocks = sdCard->read_blocks;
+    s_spiWriteBlocks = sdCard->write_blocks;
+    s_spiTestCom = sdCard->sd_test_com;
+
+    sdCard->init = sdioInit;
+    sdCard->read_blocks = sdioReadBlocks;
+    sdCard->write_blocks = sdioWriteBlocks;
+    sdCard->sd_test_com = sdioTestCom;
+}
+
+bool picostation::sdio::isActive() { return s_active; }
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "hardware/pio.h"
+#include "sd_card.h"
+
+namespace picostation {
+namespace sdio {
+// 4-bit SD bus wiring. DAT0-DAT3 must be on consecutive GPIOs.
+struct Config {
+    PIO pio;
+    uint clkGpio;
+    uint cmdGpio;
+    uint d0Gpio;
+    uint baudRate;  // CLK after identification, at most 25 MHz (default speed)
+};
+
+const Config *getConfig();  // Board wiring, see hw_config.cpp
+
+// Routes the card's init/read/write hooks through the PIO SD bus. Must be called after sd_init_driver() and
+// before the volume is mounted. If the card does not come up in 4-bit mode, the SPI hooks are restored and
+// initialization continues over SPI. Attaching again before a remount tries the 4-bit bus again.
+void attach(sd_card_t *sdCard, const Config *config);
+bool isActive();
+}  // namespace sdio
+}  // namespace picostation
@@ -0,0 +1,163 @@
+#include "sector_cache.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "disc_image.h"
+#include "pico/stdlib.h"
+#include "values.h"
+
+static_assert(picostation::SectorCache::c_streamSlots > 0 && picostation::SectorCache::c_mainSlots > 0,
+              "Sector cache too small for the pinned slots and the stream ring");
+
+void picostation::SectorCache::reset() {
+    m_disc = 0;
+    m_pinnedCount = 0;
+    m_clockHand = c_pinnedSlots;
+    m_mainEnd = c_streamStart;
+    m_streamRun = c_streamRun;
+    m_nextStreamSlot = c_streamStart;
+    m_lastSector = -1;
+    m_runLength = 0;
+    m_nextEvicted = 0;
+    memset(m_evicted, -1, sizeof(m_evicted));
+    memset(m_sectors, -1, sizeof(m_sectors));
+    memset(m_referenced, 0, sizeof(m_referenced));
+    memset(m_data, 0, sizeof(m_data));
+}
+
+int __time_critical_func(picostation::SectorCache::find)(const int sector) const {
+    const int wanted = key(sector);
+    for (int i = 0; i < c_size; i++) {
+        if (m_sectors[i] == wanted) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Audio is always played through, data once the console has read m_streamRun sectors in a row
+bool __time_critical_func(picostation::SectorCache::isStreaming)() const {
+    return m_runLength >= m_streamRun || !m_discImage->isCurrentTrackData();
+}
+
+void __time_critical_func(picostation::SectorCache::trackRun)(const int sector) {
+    if (sector == m_lastSector + 1) {
+        m_runLength++;
+    } else if (sector != m_lastSector) {
+        m_runLength = 0;
+    }
+    m_lastSector = sector;
+}
+
+// CLOCK: referenced slots get a second chance, the hand clears their bit on the way past
+int __time_critical_func(picostation::SectorCache::evictMain)() {
+    while (m_referenced[m_clockHand]) {
+        m_referenced[m_clockHand] = false;
+        m_clockHand = m_clockHand + 1 < m_mainEnd ? m_clockHand + 1 : c_pinnedSlots;
+    }
+    const int slot = m_clockHand;
+    m_clockHand = m_clockHand + 1 < m_mainEnd ? m_clockHand + 1 : c_pinnedSlots;
+    if (m_sectors[slot] != -1) {
+        m_evicted[m_nextEvicted] = m_sectors[slot];
+        m_nextEvicted = m_nextEvicted + 1 < (int)count_of(m_evicted) ? m_nextEvicted + 1 : 0;
+    }
+    return slot;
+}
+
+bool __time_critical_func(picostation::SectorCache::wasEvicted)(const int wanted) const {
+    for (const int evicted : m_evicted) {
+        if (evicted == wanted) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int __time_critical_func(picostation::SectorCache::fill)(const int sector, const bool stream) {
+    int slot;
+    if (stream) {
+        slot = m_nextStreamSlot;
+        m_nextStreamSlot = m_nextStreamSlot + 1 < c_size ? m_nextStreamSlot + 1 : c_streamStart;
+        m_stats.streamed++;
+    } else {
+        slot = evictMain();
+    }
+    m_sectors[slot] = -1;  // Not valid while it is being read, nor if the read failed
+    if (m_discImage->readData(m_data[slot], sector - c_leadIn - c_preGap)) {
+        m_sectors[slot] = key(sector);
+    }
+    m_referenced[slot] = false;
+    return slot;
+}
+
+const uint16_t *__time_critical_func(picostation::SectorCache::get)(const int sector) {
+    trackRun(sector);
+    int slot = find(sector);
+    if (slot == -1) {
+        m_stats.misses++;
+        if (wasEvicted(key(sector))) {
+            m_stats.remisses++;
+        }
+        slot = fill(sector, isStreaming());
+    } else {
+        m_stats.hits++;
+        if (slot < c_streamStart) {
+            m_referenced[slot] = true;
+        } else if (m_runLength == 0) {
+            // Returned to a streamed sector out of sequence: it is being re-read, keep it in the main slots
+            const int mainSlot = evictMain();
+            memcpy(m_data[mainSlot], m_data[slot], sizeof(m_data[slot]));
+            m_sectors[mainSlot] = key(sector);
+            m_referenced[mainSlot] = true;
+            m_sectors[slot] = -1;
+            slot = mainSlot;
+        }
+    }
+    return m_data[slot];
+}
+
+// Read-ahead of a running stream stays in the ring, anything else (seek targets) goes to the main slots
+bool __time_critical_func(picostation::SectorCache::prefetch)(const int sector) {
+    if (m_discImage->isSynthetic(sector) || find(sector) != -1) {
+        return false;
+    }
+    fill(sector, isStreaming() && sector > m_lastSector && sector <= m_lastSector + c_streamSlots);
+    return true;
+}
+
+bool picostation::SectorCache::pin(const int sector) {
+    if (m_pinnedCount == c_pinnedSlots || m_discImage->isSynthetic(sector) || find(sector) != -1) {
+        return false;
+    }
+    const int slot = m_pinnedCount;
+    if (!m_discImage->readData(m_data[slot], sector - c_leadIn - c_preGap)) {
+        return false;
+    }
+    m_sectors[slot] = key(sector);
+    m_pinnedCount++;
+    return true;
+}
+
+// Sectors of the other discs stay in the main slots but lose their referenced bit, so CLOCK takes them first. A
+// swap back to a disc finds whatever of it survived.
+void picostation::SectorCache::selectDisc(const int disc) {
+    m_disc = disc;
+    m_pinnedCount = 0;
+    m_nextStreamSlot = c_streamStart;
+    m_lastSector = -1;
+    m_runLength = 0;
+    for (int i = 0; i < c_size; i++) {
+        if (i < c_pinnedSlots || i >= c_streamStart) {
+            m_sectors[i] = -1;
+        }
+        m_referenced[i] = false;
+    }
+}
+
+// Main slots past the new end keep what they hold and can still hit, they are just not refilled
+void picostation::SectorCache::configure(const int mainSlots, const int streamRun) {
+    m_mainEnd = c_pinnedSlots + (mainSlots > 0 && mainSlots < c_mainSlots ? mainSlots : c_mainSlots);
+    m_streamRun = streamRun > 0 ? streamRun : c_streamRun;
+    m_clockHand = c_pinnedSlots;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "values.h"
+
+#ifndef PICOSTATION_SECTOR_CACHE_SIZE
+#define PICOSTATION_SECTOR_CACHE_SIZE 50
+#endif
+
+namespace picostation {
+class DiscImage;
+
+// Raw CD sectors (2352 bytes) read from the disc image, keyed by absolute sector number (lead-in included).
+// Long sequential runs (FMV, XA, CD audio) go through a small stream ring so they can't flush the main slots,
+// which use CLOCK replacement and keep re-read sectors such as directories resident. Pinned slots are filled at
+// image load and never evicted. Entries are tagged with the playlist disc they came from, so a disc swap only
+// drops the pinned slots and the stream ring and leaves the other disc's main slots to age out.
+class SectorCache {
+  public:
+    static constexpr int c_size = PICOSTATION_SECTOR_CACHE_SIZE;
+    // A fifth of the cache each, at most 8: 8 pinned, 34 main and 8 stream slots at 50, 4, 12 and 4 at 20
+    static constexpr int c_pinnedSlots = c_size / 5 < 8 ? c_size / 5 : 8;
+    static constexpr int c_streamSlots = c_pinnedSlots;
+    static constexpr int c_mainSlots = c_size - c_pinnedSlots - c_streamSlots;
+    static constexpr int c_streamStart = c_pinnedSlots + c_mainSlots;
+    static constexpr int c_streamRun = 16;  // Default for the consecutive sectors before a read counts as streaming
+
+    struct Stats {
+        uint32_t hits;
+        uint32_t misses;
+        uint32_t streamed;  // Misses that went to the stream ring
+        uint32_t remisses;  // Misses on sectors the main slots gave up recently, what pinning is for
+    };
+
+    SectorCache(DiscImage *discImage) : m_discImage(discImage) { reset(); }
+
+    void reset();
+    const uint16_t *get(const int sector);  // Reads the sector on a miss
+    bool prefetch(const int sector);        // Returns true if the sector had to be read, synthetic ones never are
+    bool pin(const int sector);             // Until the next reset, false when full or the read failed
+    void selectDisc(const int disc);        // Swaps to another disc of the playlist, unpins everything
+    bool isStreaming() const;
+    // Per image: main slots in use, up to c_mainSlots, and the run that counts as streaming. 0 keeps the default.
+    void configure(const int mainSlots, const int streamRun);
+
+    Stats getStats() const { return m_stats; }
+    void resetStats() { m_stats = {}; }
+
+  private:
+    static constexpr int c_discShift = 20;
+    static_assert(c_sectorMax + c_leadIn < (1 << c_discShift), "Sector numbers overlap the disc tag");
+
+    int key(const int sector) const { return sector | (m_disc << c_discShift); }
+    int find(const int sector) const;
+    int fill(const int sector, const bool stream);
+    int evictMain();
+    void trackRun(const int sector);
+    bool wasEvicted(const int wanted) const;
+
+    DiscImage *m_discImage;
+    int m_disc = 0;
+    int m_sectors[c_size];
+    bool m_referenced[c_size];
+    int m_pinnedCount = 0;
+    int m_clockHand = c_pinnedSlots;
+    int m_mainEnd = c_streamStart;  // Main slots in use end here
+    int m_streamRun = c_streamRun;
+    int m_nextStreamSlot = c_streamStart;
+    int m_lastSector = -1;
+    int m_runLength = 0;
+    int m_evicted[c_mainSlots * 2];  // Keys the CLOCK hand took, oldest overwritten first
+    int m_nextEvicted = 0;
+    Stats m_stats = {};
+    uint16_t m_data[c_size][c_cdSamplesBytes / sizeof(uint16_t)];
+};
+}  // namespace picostation
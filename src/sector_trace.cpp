@@ -0,0 +1,93 @@
+#include "sector_trace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ff.h"
+#include "logging.h"
+#include "pico/stdlib.h"
+#include "utils.h"
+
+#if DEBUG_I2S
+#define DEBUG_PRINT(...) printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINT(...) while (0)
+#endif
+
+static constexpr uint c_bufferRecords = 512;
+static constexpr uint c_flushRecords = 128;             // Most written at once, fewer only after c_flushIntervalUs
+static constexpr uint32_t c_flushIntervalUs = 1000000;  // Also how often the file is synced
+
+static picostation::sectortrace::Record s_records[c_bufferRecords];
+static uint s_head = 0;  // Next record to write to the file
+static uint s_count = 0;
+static uint32_t s_dropped = 0;
+static uint32_t s_lastFlush = 0;
+static uint32_t s_lastSync = 0;
+static FIL s_file;
+static bool s_open = false;
+
+// Up to the end of the ring, the rest goes out with the next write
+static void writeRecords(const uint maxRecords) {
+    const uint length = MIN(MIN(s_count, maxRecords), c_bufferRecords - s_head);
+    UINT bw;
+    f_write(&s_file, &s_records[s_head], length * sizeof(picostation::sectortrace::Record), &bw);
+    s_head = (s_head + length) % c_bufferRecords;
+    s_count -= length;
+}
+
+void picostation::sectortrace::open(const char *cuePath) {
+    if (s_open) {
+        while (s_count) {
+            writeRecords(c_bufferRecords);
+        }
+        f_close(&s_file);
+        s_open = false;
+    }
+    s_head = 0;
+    s_count = 0;
+    s_dropped = 0;
+
+    TCHAR path[256];
+    replaceExtension(cuePath, ".trc", path, sizeof(path));
+
+    if (f_open(&s_file, path, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) {
+        DEBUG_PRINT("%s: can't create trace\n", path);
+        return;
+    }
+    const Header header = {{'P', 'S', 'T', 'R'}, 1, sizeof(Record)};
+    UINT bw;
+    f_write(&s_file, &header, sizeof(header), &bw);
+    s_open = true;
+    s_lastFlush = time_us_32();
+    s_lastSync = s_lastFlush;
+}
+
+void __time_critical_func(picostation::sectortrace::record)(const int sector, const uint8_t flags) {
+    if (!s_open) {
+        return;
+    }
+    if (s_count == c_bufferRecords) {
+        s_dropped++;
+        return;
+    }
+    s_records[(s_head + s_count) % c_bufferRecords] = {time_us_32(), ((uint32_t)flags << 24) | (sector & 0xFFFFFF)};
+    s_count++;
+}
+
+void picostation::sectortrace::flush() {
+    if (!s_open || s_count == 0 || (s_count < c_flushRecords && (time_us_32() - s_lastFlush) < c_flushIntervalUs)) {
+        return;
+    }
+    // Bounded so one call never holds core1 for long, a full ring drains over a few calls
+    writeRecords(c_flushRecords);
+    s_lastFlush = time_us_32();
+    if ((s_lastFlush - s_lastSync) >= c_flushIntervalUs) {
+        f_sync(&s_file);
+        s_lastSync = s_lastFlush;
+    }
+    if (s_dropped) {
+        DEBUG_PRINT("trace: %u records dropped\n", (unsigned)s_dropped);
+        s_dropped = 0;
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace picostation {
+// Every sector I2S::start asks the cache for, written to <cue name>.trc for tools/cache_sim. Built in with
+// PICOSTATION_SECTOR_TRACE. The file is the 8 byte header then one Record per request, all little endian.
+// Kept free of SDK and FatFs types, the host tool includes it.
+namespace sectortrace {
+namespace Flags {
+enum : uint8_t {
+    DATA = 1 << 0,      // Data track, otherwise audio
+    HIT = 1 << 1,       // Served without an SD read
+    PREFETCH = 1 << 2,  // Seek target read-ahead rather than a sector the console is reading
+    STREAM = 1 << 3,    // The cache classed it as part of a sequential stream
+};
+}
+
+struct Header {
+    char magic[4];  // "PSTR"
+    uint16_t version;
+    uint16_t recordSize;
+};
+
+struct Record {
+    uint32_t timeUs;       // time_us_32(), wraps
+    uint32_t sectorFlags;  // Absolute sector in the low 24 bits, Flags in the high 8
+};
+
+void open(const char *cuePath);  // Starts a new trace, call at image load
+void record(const int sector, const uint8_t flags);
+void flush();  // Writes buffered records, call while nothing is waiting on core1
+}  // namespace sectortrace
+}  // namespace picostation
@@ -0,0 +1,83 @@
+#include "seek_model.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "pico/stdlib.h"
+#include "values.h"
+
+// Indexed by Profile
+static constexpr picostation::seekmodel::Timing c_timings[picostation::seekmodel::Profile::COUNT] = {
+    {.settleUs = 15000,
+     .actuatorTrackUs = 0,
+     .actuatorMaxTracks = 0,
+     .fullStrokeUs = 0,
+     .doubleSpeedExtraUs = 0,
+     .sledStepUs = 15},
+    {.settleUs = 3000,
+     .actuatorTrackUs = 40,
+     .actuatorMaxTracks = 64,
+     .fullStrokeUs = 250000,
+     .doubleSpeedExtraUs = 20000,
+     .sledStepUs = 30},
+    {.settleUs = 1000,
+     .actuatorTrackUs = 10,
+     .actuatorMaxTracks = 64,
+     .fullStrokeUs = 40000,
+     .doubleSpeedExtraUs = 0,
+     .sledStepUs = 10},
+};
+
+// Spiral geometry, the curve fitted to a retail disc. Shared by all profiles: it is a property of the disc, not
+// of the mechanism, and the sled emulation is tuned against exactly these values.
+static constexpr double c_sectorQuadratic = 0.00031499;
+static constexpr double c_sectorLinear = 9.357516535;
+static constexpr double c_perTrackSlope = 0.000616397;
+static constexpr double c_perTrackBase = 9;
+
+static uint s_profile = picostation::seekmodel::Profile::LEGACY;
+static picostation::seekmodel::Stats s_stats = {0, 0};
+
+void picostation::seekmodel::setProfile(const uint profile) {
+    if (profile < Profile::COUNT) {
+        s_profile = profile;
+    }
+}
+
+uint picostation::seekmodel::getProfile() { return s_profile; }
+
+uint32_t __time_critical_func(picostation::seekmodel::jumpDelayUs)(const int fromTrack, const int toTrack,
+                                                                   const int speed) {
+    const Timing &timing = c_timings[s_profile];
+    const uint32_t distance = abs(toTrack - fromTrack);
+
+    uint32_t delay = timing.settleUs;
+    if (distance <= timing.actuatorMaxTracks) {
+        delay += distance * timing.actuatorTrackUs;
+    } else {
+        // Accelerate/decelerate limited: time grows with the square root of the distance
+        delay += timing.fullStrokeUs * sqrtf((float)distance / c_trackMax);
+    }
+    if (speed == 2) {
+        delay += timing.doubleSpeedExtraUs;
+    }
+
+    s_stats.jumps++;
+    s_stats.totalDelayUs += delay;
+    return delay;
+}
+
+uint32_t __time_critical_func(picostation::seekmodel::sledStepUs)() { return c_timings[s_profile].sledStepUs; }
+
+int __time_critical_func(picostation::seekmodel::trackToSector)(const int track) {
+    return (double)track * track * c_sectorQuadratic + track * c_sectorLinear;
+}
+
+int __time_critical_func(picostation::seekmodel::sectorsPerTrack)(const int track) {
+    return lround(track * c_perTrackSlope + c_perTrackBase);
+}
+
+picostation::seekmodel::Stats picostation::seekmodel::getStats() { return s_stats; }
+
+void picostation::seekmodel::resetStats() { s_stats = {0, 0}; }
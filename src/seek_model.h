@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+
+namespace picostation {
+namespace seekmodel {
+namespace Profile {
+enum : uint {
+    LEGACY = 0,    // Fixed 15 ms jumps, 15 us sled steps: the original timings
+    ACCURATE = 1,  // Distance dependent, close to a real KSM-440 mechanism
+    FAST = 2,      // Short latencies for faster loading, less compatible
+    COUNT
+};
+}
+
+struct Timing {
+    uint32_t settleUs;            // Every jump: tracking and focus lock at the destination
+    uint32_t actuatorTrackUs;     // Per track for jumps the tracking actuator covers on its own
+    uint32_t actuatorMaxTracks;   // Longer jumps move the sled
+    uint32_t fullStrokeUs;        // Sled travel over the whole disc, scales with sqrt(distance)
+    uint32_t doubleSpeedExtraUs;  // Spindle has to re-lock CLV at 2x
+    uint32_t sledStepUs;          // Per track crossing during sled moves (COUT rate)
+};
+
+struct Stats {
+    uint32_t jumps;
+    uint64_t totalDelayUs;  // Emulated seek time handed out since the last reset
+};
+
+void setProfile(const uint profile);
+uint getProfile();
+
+// Auto sequence jump latency; legacy keeps the flat delay for any distance
+uint32_t jumpDelayUs(const int fromTrack, const int toTrack, const int speed);
+uint32_t sledStepUs();
+
+// Spiral geometry: absolute sector at the start of a track, and sectors per revolution at a track
+int trackToSector(const int track);
+int sectorsPerTrack(const int track);
+
+Stats getStats();
+void resetStats();
+}  // namespace seekmodel
+}  // namespace picostation
@@ -24,7 +24,17 @@ void picostation::SubQ::printf_subq(const uint8_t *data) {
     }
 }
 
-void picostation::SubQ::start_subq(const int sector) {
+#if DEBUG_SUBQ
+// Time from the SubQ deadline to the frame being queued: generateSubQ and the PIO setup. Flash code here waits
+// on XIP misses whenever core1's SD and FatFs code has evicted it from the cache.
+static uint32_t s_minUs = UINT32_MAX;
+static uint32_t s_maxUs = 0;
+#endif
+
+void __time_critical_func(picostation::SubQ::start_subq)(const int sector) {
+#if DEBUG_SUBQ
+    const uint32_t startUs = time_us_32();
+#endif
     const SubQ::Data tracksubq = m_discImage->generateSubQ(sector);
     subq_program_init(PIOInstance::SUBQ, SM::SUBQ, g_subqOffset, Pin::SQSO, Pin::SQCK);
     pio_sm_set_enabled(PIOInstance::SUBQ, SM::SUBQ, true);
@@ -38,9 +48,14 @@ void picostation::SubQ::start_subq(const int sector) {
     pio_sm_put_blocking(PIOInstance::SUBQ, SM::SUBQ, sub[2]);
 
 #if DEBUG_SUBQ
+    const uint32_t elapsedUs = time_us_32() - startUs;
+    s_minUs = MIN(s_minUs, elapsedUs);
+    s_maxUs = MAX(s_maxUs, elapsedUs);
     if (sector % 50 == 0) {
         printf_subq(tracksubq.raw);
-        DEBUG_PRINT("%d\n", sector);
+        DEBUG_PRINT("%d, %u-%u us\n", sector, (unsigned)s_minUs, (unsigned)s_maxUs);
+        s_minUs = UINT32_MAX;
+        s_maxUs = 0;
     }
 #endif
 }
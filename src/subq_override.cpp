@@ -0,0 +1,151 @@
+#include "subq_override.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "logging.h"
+#include "pico/stdlib.h"
+#include "utils.h"
+#include "values.h"
+
+#if DEBUG_CUE
+#define DEBUG_PRINT(...) printf(__VA_ARGS__)
+#else
+#define DEBUG_PRINT(...) while (0)
+#endif
+
+namespace OverrideFormat {
+enum : uint8_t {
+    SBI_FULL = 1,      // Q bytes 0-9
+    SBI_RELATIVE = 2,  // Q bytes 3-5, relative MSF
+    SBI_ABSOLUTE = 3,  // Q bytes 7-9, absolute MSF
+    LSD = 4,           // Q bytes 0-11, CRC included
+};
+}
+
+static int fromBCD(const uint8_t value) { return (value >> 4) * 10 + (value & 0x0F); }
+
+// Absolute MSF as stored in the files, 00:00:00 is the end of the lead-in
+static int msfToSector(const uint8_t *msf) {
+    return (fromBCD(msf[0]) * 60 + fromBCD(msf[1])) * 75 + fromBCD(msf[2]) + c_leadIn;
+}
+
+void picostation::SubQOverrides::load(const TCHAR *cuePath) {
+    TCHAR path[256];
+    m_count = 0;
+    replaceExtension(cuePath, ".sbi", path, sizeof(path));
+    if (!loadSBI(path)) {
+        replaceExtension(cuePath, ".lsd", path, sizeof(path));
+        loadLSD(path);
+    }
+    if (m_count) {
+        DEBUG_PRINT("%s: %d SubQ overrides\n", path, m_count);
+    }
+}
+
+int __time_critical_func(picostation::SubQOverrides::search)(const int sector) const {
+    int low = 0;
+    int high = m_count - 1;
+    while (low <= high) {
+        const int middle = (low + high) / 2;
+        if (m_entries[middle].sector < sector) {
+            low = middle + 1;
+        } else if (m_entries[middle].sector > sector) {
+            high = middle - 1;
+        } else {
+            return middle;
+        }
+    }
+    return -1;
+}
+
+void __time_critical_func(picostation::SubQOverrides::apply)(const int index, SubQ::Data *data) const {
+    const Entry &entry = m_entries[index];
+    switch (entry.format) {
+        case OverrideFormat::SBI_FULL:
+            memcpy(data->raw, entry.q, 10);
+            break;
+        case OverrideFormat::SBI_RELATIVE:
+            memcpy(data->raw + 3, entry.q, 3);
+            break;
+        case OverrideFormat::SBI_ABSOLUTE:
+            memcpy(data->raw + 7, entry.q, 3);
+            break;
+        case OverrideFormat::LSD:
+            memcpy(data->raw, entry.q, 10);
+            break;
+    }
+}
+
+void __time_critical_func(picostation::SubQOverrides::applyCRC)(const int index, SubQ::Data *data) const {
+    const Entry &entry = m_entries[index];
+    if (entry.format == OverrideFormat::LSD) {
+        data->raw[10] = entry.q[10];
+        data->raw[11] = entry.q[11];
+    } else {
+        // SBI files carry no CRC, the frames they describe are the ones that fail the check on the disc
+        data->crc ^= 0xFFFF;
+    }
+}
+
+// Kept sorted as entries come in, files are small and almost always sorted already
+void picostation::SubQOverrides::insert(const int sector, const uint8_t format, const uint8_t *q, const int length) {
+    int i = search(sector);
+    if (i < 0) {
+        if (m_count == c_maxEntries) {
+            DEBUG_PRINT("SubQ override table full\n");
+            return;
+        }
+        i = m_count;
+        while (i > 0 && m_entries[i - 1].sector > sector) {
+            m_entries[i] = m_entries[i - 1];
+            i--;
+        }
+        m_count++;
+    }
+    m_entries[i].sector = sector;
+    m_entries[i].format = format;
+    memcpy(m_entries[i].q, q, length);
+}
+
+// "SBI\0", then per sector: MSF, format, 10 or 3 bytes of Q
+bool picostation::SubQOverrides::loadSBI(const TCHAR *path) {
+    FIL file;
+    if (f_open(&file, path, FA_READ) != FR_OK) {
+        return false;
+    }
+    uint8_t record[4 + 10];
+    UINT br;
+    bool ok = f_read(&file, record, 4, &br) == FR_OK && br == 4 && memcmp(record, "SBI\0", 4) == 0;
+    while (ok && f_read(&file, record, 4, &br) == FR_OK && br == 4) {
+        const uint8_t format = record[3];
+        const UINT length = (format == OverrideFormat::SBI_FULL) ? 10 : 3;
+        if (format < OverrideFormat::SBI_FULL || format > OverrideFormat::SBI_ABSOLUTE ||
+            f_read(&file, record + 4, length, &br) != FR_OK || br != length) {
+            ok = false;
+            break;
+        }
+        insert(msfToSector(record), format, record + 4, length);
+    }
+    f_close(&file);
+    if (!ok) {
+        DEBUG_PRINT("%s: invalid SBI file\n", path);
+        m_count = 0;
+    }
+    return ok;
+}
+
+// Per sector: MSF, 12 bytes of Q
+bool picostation::SubQOverrides::loadLSD(const TCHAR *path) {
+    FIL file;
+    if (f_open(&file, path, FA_READ) != FR_OK) {
+        return false;
+    }
+    uint8_t record[3 + 12];
+    UINT br;
+    while (f_read(&file, record, sizeof(record), &br) == FR_OK && br == sizeof(record)) {
+        insert(msfToSector(record), OverrideFormat::LSD, record + 3, 12);
+    }
+    f_close(&file);
+    return true;
+}
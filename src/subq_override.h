@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ff.h"
+#include "subq.h"
+
+namespace picostation {
+// Q subchannel frames that differ from the generated ones, such as the LibCrypt sectors of protected
+// titles. Loaded from a .sbi or .lsd file next to the cue sheet, kept sorted by sector.
+class SubQOverrides {
+  public:
+    static constexpr int c_maxEntries = 256;
+
+    void load(const TCHAR *cuePath);
+    void clear() { m_count = 0; }
+
+    // sector is absolute, lead-in included. Returns -1 when there is no override.
+    int find(const int sector) const {
+        if (m_count == 0 || sector < m_entries[0].sector || sector > m_entries[m_count - 1].sector) {
+            return -1;
+        }
+        return search(sector);
+    }
+    void apply(const int index, SubQ::Data *data) const;     // Before the CRC is computed
+    void applyCRC(const int index, SubQ::Data *data) const;  // After
+
+  private:
+    struct Entry {
+        int sector;
+        uint8_t format;
+        uint8_t q[12];
+    };
+
+    int search(const int sector) const;
+    bool loadSBI(const TCHAR *path);
+    bool loadLSD(const TCHAR *path);
+    void insert(const int sector, const uint8_t format, const uint8_t *q, const int length);
+
+    Entry m_entries[c_maxEntries];
+    int m_count = 0;
+};
+}  // namespace picostation
@@ -1,9 +1,11 @@
 #include "utils.h"
 
-extern inline int trackToSector(int track);
-extern inline int sectorsPerTrack(int track);
+#include <stdio.h>
+#include <string.h>
 
-int clamp(const int value, const int min, const int max) {
+#include "pico/stdlib.h"
+
+int __time_critical_func(clamp)(const int value, const int min, const int max) {
     if (value < 0) {
         return 0;
     } else if (value > max) {
@@ -11,4 +13,14 @@ int clamp(const int value, const int min, const int max) {
     } else {
         return value;
     }
-}
\ No newline at end of file
+}
+
+void replaceExtension(const char *path, const char *extension, char *out, const size_t size) {
+    snprintf(out, size, "%s", path);
+    char *dot = strrchr(out, '.');
+    char *slash = strrchr(out, '/');
+    if (dot && (!slash || dot > slash)) {
+        *dot = 0;
+    }
+    strncat(out, extension, size - strlen(out) - 1);
+}
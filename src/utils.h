@@ -1,10 +1,9 @@
 #pragma once
 
 #include <math.h>
+#include <stddef.h>
 
 int clamp(const int value, const int min, const int max);
+// Copies path to out with its extension (if the file name has one) replaced by extension, "" just strips it
+void replaceExtension(const char *path, const char *extension, char *out, const size_t size);
 
-// For calculating sector at a position in the spiral track/groove
-inline int trackToSector(const int track) { return pow(track, 2) * 0.00031499 + track * 9.357516535; }
-
-inline int sectorsPerTrack(const int track) { return round(track * 0.000616397 + 9); }
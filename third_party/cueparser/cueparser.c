@@ -92,8 +92,6 @@ struct end_Closure {
     const char* error;
 };
 
-static void closure_generic_free(struct CueClosure* closure) { free(closure); }
-
 static void end_closure_call(struct CueClosure* closure_) {
     struct end_Closure* closure = (struct end_Closure*)closure_;
     closure->parser->cb(closure->parser, closure->scheduler, closure->error);
@@ -203,9 +201,9 @@ static int32_t timecodeToSectorNumber(char* timecode) {
 }
 
 void end_parse(struct CueParser* parser, struct CueScheduler* scheduler, const char* error) {
-    struct end_Closure* closure = malloc(sizeof(struct end_Closure));
+    struct end_Closure* closure = Scheduler_allocateClosure(sizeof(struct end_Closure));
     assert(closure);
-    closure->destroy = closure_generic_free;
+    closure->destroy = Scheduler_freeClosure;
     closure->call = end_closure_call;
     closure->parser = parser;
     closure->error = error;
@@ -491,6 +489,7 @@ static void parse(struct CueParser* parser, struct CueFile* file, struct CueSche
                     } else {
                         track->indices[0] = track->indices[1];
                         track->indices[1] += parser->currentPregap;
+                        track->pregap = parser->currentPregap;
                         track->fileOffset += parser->currentPregap;
                         parser->currentSectorNumber += parser->currentPregap;
                     }
@@ -515,15 +514,25 @@ static void parse(struct CueParser* parser, struct CueFile* file, struct CueSche
                 end_parse(parser, scheduler, "cuesheet PERFORMER argument not supported at the moment");
                 return;
                 break;
-            case CUE_PARSER_POSTGAP:
+            case CUE_PARSER_POSTGAP: {
                 if (keyword == KW_EMPTY) {
                     end_parse(parser, scheduler, "cuesheet POSTGAP missing its argument");
                     return;
                 }
+                struct CueTrack* track = &parser->disc->tracks[parser->currentTrack];
+                if ((parser->currentTrack == 0) || (track->indexCount == -1)) {
+                    end_parse(parser, scheduler, "cuesheet POSTGAP before an INDEX");
+                    return;
+                }
+                int32_t postgapLength = timecodeToSectorNumber(parser->word);
+                if (postgapLength < 0) {
+                    end_parse(parser, scheduler, "cuesheet POSTGAP length invalid");
+                    return;
+                }
+                // Not in the file: the sectors after this track move down, see the TRACK and EOF handling
+                track->postgap = postgapLength;
                 parser->state = CUE_PARSER_START;
-                end_parse(parser, scheduler, "cuesheet POSTGAP argument not supported at the moment");
-                return;
-                break;
+            } break;
             case CUE_PARSER_PREGAP: {
                 if (keyword == KW_EMPTY) {
                     end_parse(parser, scheduler, "cuesheet PREGAP missing its argument");
@@ -594,7 +603,9 @@ static void parse(struct CueParser* parser, struct CueFile* file, struct CueSche
                     track->file->references++;
                     track->fileOffset = 0;
                     track->indexCount = -1;
+                    track->pregap = 0;
                     track->postgap = 0;
+                    track->sectorSize = 2352;
                     track->size = 0;
                     track->trackType = TRACK_TYPE_UNKNOWN;
                     track->compressed = 0;
@@ -603,12 +614,17 @@ static void parse(struct CueParser* parser, struct CueFile* file, struct CueSche
                     track->preEmphasis = 0;
                     track->serialCopyManagementSystem = 0;
                     parser->currentPregap = 0;
+                    uint32_t previousPostgap = trackNum > 1 ? parser->disc->tracks[trackNum - 1].postgap : 0;
                     if (parser->isTrackANewFile) {
-                        parser->currentSectorNumber += (parser->previousFileSize + 2351) / 2352;
+                        // The previous file's layout is the one of its last track, track 0 is the lead-in
+                        uint32_t sectorSize = trackNum > 1 ? parser->disc->tracks[trackNum - 1].sectorSize : 2352;
+                        parser->currentSectorNumber += (parser->previousFileSize + sectorSize - 1) / sectorSize;
+                        parser->currentSectorNumber += previousPostgap;
                         parser->isTrackANewFile = 0;
                         track->fileOffset = parser->currentSectorNumber;
                     } else {
-                        track->fileOffset = parser->disc->tracks[parser->currentTrack - 1].fileOffset;
+                        parser->currentSectorNumber += previousPostgap;
+                        track->fileOffset = parser->disc->tracks[parser->currentTrack - 1].fileOffset + previousPostgap;
                     }
                     parser->disc->trackCount = trackNum;
                 }
@@ -635,18 +651,18 @@ static void parse(struct CueParser* parser, struct CueFile* file, struct CueSche
                         return;
                         break;
                     case KW_MODE1_2048:
-                        end_parse(parser, scheduler, "cuesheet TRACK type MODE1_2048 not supported at the moment");
+                        parser->disc->tracks[parser->currentTrack].trackType = TRACK_TYPE_DATA;
+                        parser->disc->tracks[parser->currentTrack].sectorSize = 2048;
                         parser->state = CUE_PARSER_START;
-                        return;
                         break;
                     case KW_MODE1_2352:
                         parser->disc->tracks[parser->currentTrack].trackType = TRACK_TYPE_DATA;
                         parser->state = CUE_PARSER_START;
                         break;
                     case KW_MODE2_2336:
-                        end_parse(parser, scheduler, "cuesheet TRACK type MODE2_2336 not supported at the moment");
+                        parser->disc->tracks[parser->currentTrack].trackType = TRACK_TYPE_DATA;
+                        parser->disc->tracks[parser->currentTrack].sectorSize = 2336;
                         parser->state = CUE_PARSER_START;
-                        return;
                         break;
                     case KW_MODE2_2352:
                         parser->disc->tracks[parser->currentTrack].trackType = TRACK_TYPE_DATA;
@@ -697,8 +713,9 @@ static void parse_eof(struct CueParser* parser, struct CueFile* file, struct Cue
         struct CueTrack* track = &parser->disc->tracks[i];
         prevTrack->size = track->indices[0] - prevTrack->indices[0];
     }
-    parser->currentSectorNumber += (parser->currentFileSize + 2351) / 2352;
     struct CueTrack* track = &parser->disc->tracks[parser->disc->trackCount];
+    parser->currentSectorNumber += (parser->currentFileSize + track->sectorSize - 1) / track->sectorSize;
+    parser->currentSectorNumber += track->postgap;
     track->size = parser->currentSectorNumber - track->indices[0];
     end_parse(parser, scheduler, NULL);
 }
@@ -54,7 +54,10 @@ struct CueTrack {
                                  // index 0 is for the pregap, and shouldn't be considered
                                  // physically present within the data files
                                  // the lead-in isn't taken into account
+    uint32_t pregap;             // size of the PREGAP in sectors, the ones before indices[1] that no file holds
     uint32_t postgap;            // size of the postgap in sectors
+    uint32_t sectorSize;         // bytes per sector in the file: 2352 for raw tracks, 2048 for MODE1/2048
+                                 // and 2336 for MODE2/2336, whose sync/header (and EDC/ECC) get rebuilt
     enum CueTrackType trackType;
     int compressed;
     int digitalCopyPermitted;
@@ -65,7 +68,8 @@ struct CueTrack {
 
 struct CueDisc {
     int trackCount;
-    struct CueTrack tracks[MAXTRACK];  // track 0 isn't valid; technically can be considered the lead-in
+    struct CueTrack tracks[MAXTRACK + 1];  // track 0 isn't valid; technically can be considered the lead-in
+                                           // tracks[trackCount + 1] is filled in as the lead-out
     char catalog[14];
     char isrc[13];
 };
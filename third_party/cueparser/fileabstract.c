@@ -31,8 +31,6 @@ SOFTWARE.
 
 #include "cueparser/scheduler.h"
 
-static void closure_generic_free(struct CueClosure *closure) { free(closure); }
-
 struct close_Closure {
     struct CueScheduler *scheduler;
     void (*destroy)(struct CueClosure *);
@@ -49,8 +47,8 @@ static void close_closure_call(struct CueClosure *closure_) {
 
 void File_schedule_close(struct CueFile *file, struct CueScheduler *scheduler,
                          void (*cb)(struct CueFile *, struct CueScheduler *)) {
-    struct close_Closure *closure = malloc(sizeof(struct close_Closure));
-    closure->destroy = closure_generic_free;
+    struct close_Closure *closure = Scheduler_allocateClosure(sizeof(struct close_Closure));
+    closure->destroy = Scheduler_freeClosure;
     closure->call = close_closure_call;
     closure->file = file;
     closure->cb = cb;
@@ -74,8 +72,8 @@ static void size_closure_call(struct CueClosure *closure_) {
 
 void File_schedule_size(struct CueFile *file, struct CueScheduler *scheduler, uint64_t size,
                         void (*cb)(struct CueFile *, struct CueScheduler *, uint64_t)) {
-    struct size_Closure *closure = malloc(sizeof(struct size_Closure));
-    closure->destroy = closure_generic_free;
+    struct size_Closure *closure = Scheduler_allocateClosure(sizeof(struct size_Closure));
+    closure->destroy = Scheduler_freeClosure;
     closure->call = size_closure_call;
     closure->file = file;
     closure->size = size;
@@ -103,8 +101,8 @@ void File_schedule_read(struct CueFile *file, struct CueScheduler *scheduler, in
                         uint8_t *buffer,
                         void (*cb)(struct CueFile *, struct CueScheduler *, int error, uint32_t amount,
                                    uint8_t *buffer)) {
-    struct read_Closure *closure = malloc(sizeof(struct read_Closure));
-    closure->destroy = closure_generic_free;
+    struct read_Closure *closure = Scheduler_allocateClosure(sizeof(struct read_Closure));
+    closure->destroy = Scheduler_freeClosure;
     closure->call = read_closure_call;
     closure->file = file;
     closure->error = error;
@@ -132,8 +130,8 @@ static void write_closure_call(struct CueClosure *closure_) {
 
 void File_schedule_write(struct CueFile *file, struct CueScheduler *scheduler, int error, uint32_t amount,
                          void (*cb)(struct CueFile *, struct CueScheduler *, int error, uint32_t amount)) {
-    struct write_Closure *closure = malloc(sizeof(struct write_Closure));
-    closure->destroy = closure_generic_free;
+    struct write_Closure *closure = Scheduler_allocateClosure(sizeof(struct write_Closure));
+    closure->destroy = Scheduler_freeClosure;
     closure->call = write_closure_call;
     closure->file = file;
     closure->error = error;
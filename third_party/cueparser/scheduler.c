@@ -33,6 +33,61 @@ int Scheduler_hasPendingEvents(struct CueScheduler *scheduler) { return 0; }
 void Scheduler_processEvents(struct CueScheduler *scheduler) {}
 #endif
 
+union ClosureSlot {
+    union ClosureSlot *nextFree;
+    max_align_t align;
+    uint8_t storage[CUE_CLOSURE_SLOT_SIZE];
+};
+
+static union ClosureSlot s_closurePool[CUE_CLOSURE_POOL_SIZE];
+static union ClosureSlot *s_closureFreeList;
+static int s_closurePoolReady;
+static uint32_t s_closuresInUse;
+static struct CueClosureStats s_closureStats;
+
+static int is_pool_closure(const void *closure) {
+    const uint8_t *p = (const uint8_t *)closure;
+    return p >= (const uint8_t *)s_closurePool && p < (const uint8_t *)(s_closurePool + CUE_CLOSURE_POOL_SIZE);
+}
+
+void *Scheduler_allocateClosure(size_t size) {
+    if (!s_closurePoolReady) {
+        for (unsigned i = 0; i < CUE_CLOSURE_POOL_SIZE; i++) {
+            s_closurePool[i].nextFree = i + 1 < CUE_CLOSURE_POOL_SIZE ? &s_closurePool[i + 1] : NULL;
+        }
+        s_closureFreeList = s_closurePool;
+        s_closurePoolReady = 1;
+    }
+    s_closureStats.allocations++;
+    if (++s_closuresInUse > s_closureStats.peakInUse) s_closureStats.peakInUse = s_closuresInUse;
+    if (size <= sizeof(union ClosureSlot) && s_closureFreeList) {
+        union ClosureSlot *slot = s_closureFreeList;
+        s_closureFreeList = slot->nextFree;
+        return slot;
+    }
+    s_closureStats.heapFallbacks++;
+    return malloc(size);
+}
+
+void Scheduler_freeClosure(struct CueClosure *closure) {
+    s_closuresInUse--;
+    if (is_pool_closure(closure)) {
+        union ClosureSlot *slot = (union ClosureSlot *)closure;
+        slot->nextFree = s_closureFreeList;
+        s_closureFreeList = slot;
+    } else {
+        free(closure);
+    }
+}
+
+struct CueClosureStats Scheduler_getClosureStats(void) { return s_closureStats; }
+
+void Scheduler_resetClosureStats(void) {
+    s_closureStats.allocations = 0;
+    s_closureStats.heapFallbacks = 0;
+    s_closureStats.peakInUse = s_closuresInUse;
+}
+
 void Scheduler_construct(struct CueScheduler *scheduler) { scheduler->top = NULL; }
 
 void Scheduler_schedule(struct CueScheduler *scheduler, struct CueClosure *closure) {
@@ -30,6 +30,17 @@ SOFTWARE.
 extern "C" {
 #endif
 
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef CUE_CLOSURE_POOL_SIZE
+#define CUE_CLOSURE_POOL_SIZE 8
+#endif
+
+#ifndef CUE_CLOSURE_SLOT_SIZE
+#define CUE_CLOSURE_SLOT_SIZE 64
+#endif
+
 struct CueScheduler;
 
 struct CueClosure {
@@ -44,6 +55,19 @@ struct CueScheduler {
     void *opaque;
 };
 
+struct CueClosureStats {
+    uint32_t allocations;
+    uint32_t heapFallbacks;  // Pool was full or the closure too large
+    uint32_t peakInUse;
+};
+
+// Closures come from a fixed pool rather than the heap, so a parse leaves no holes between the allocations
+// that outlive it (files, FatFs buffers). Closures are short lived, the pool is empty again once a run ends.
+void *Scheduler_allocateClosure(size_t size);
+void Scheduler_freeClosure(struct CueClosure *);
+struct CueClosureStats Scheduler_getClosureStats(void);
+void Scheduler_resetClosureStats(void);
+
 void Scheduler_construct(struct CueScheduler *);
 int Scheduler_hasPendingEvents(struct CueScheduler *);
 void Scheduler_processEvents(struct CueScheduler *);
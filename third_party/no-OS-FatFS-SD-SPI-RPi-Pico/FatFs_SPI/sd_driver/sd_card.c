@@ -184,6 +184,22 @@ specific language governing permissions and limitations under the License.
 static bool crc_on = true;
 #endif
 
+/* Keep the card in CMD18 between calls so that sequential reads continue the
+ * open multi-block transfer instead of paying for a new command, and receive
+ * each block with a chained data+CRC DMA instead of per-byte transfers. */
+#ifndef SD_STREAMING_READS
+#define SD_STREAMING_READS 1
+#endif
+
+/* On a data CRC error, drop the SPI clock to the next lower divider and
+ * retry, so a card that is marginal at the tuned rate degrades instead of
+ * failing reads mid-game. */
+#ifndef SD_CLOCK_FALLBACK
+#define SD_CLOCK_FALLBACK 1
+#endif
+#define SD_CLOCK_FALLBACK_RETRIES 2
+#define SD_CLOCK_FALLBACK_MIN_BAUD (10 * 1000 * 1000)
+
 #define TRACE_PRINTF(fmt, args...)
 // #define TRACE_PRINTF printf
 
@@ -363,6 +379,9 @@ static bool sd_wait_ready(sd_card_t *pSD, int timeout) {
     return (resp > 0x00);
 }
 
+static int sd_cmd(sd_card_t *pSD, const cmdSupported cmd, uint32_t arg,
+                  bool isAcmd, uint32_t *resp);
+
 // An SD card can only do one thing at a time.
 static void sd_lock(sd_card_t *pSD) {
     myASSERT(mutex_is_initialized(&pSD->mutex));
@@ -376,13 +395,35 @@ static void sd_unlock(sd_card_t *pSD) {
 // Locks the SD card and acquires its SPI
 static void sd_acquire(sd_card_t *pSD) {
     sd_lock(pSD);
+#if SD_STREAMING_READS
+    // Chip select stays asserted while a multi-block read is open: the fill
+    // byte sent on select would clock away the next block's start token.
+    if (pSD->stream_active) {
+        spi_lock(pSD->spi);
+        return;
+    }
+#endif
     sd_spi_acquire(pSD);
 }
 static void sd_release(sd_card_t *pSD) {
     sd_unlock(pSD);
+#if SD_STREAMING_READS
+    if (pSD->stream_active) {
+        spi_unlock(pSD->spi);
+        return;
+    }
+#endif
     sd_spi_release(pSD);
 }
 
+// Ends an open multi-block read. Must be called with the card acquired.
+static void sd_stream_stop(sd_card_t *pSD) {
+    if (pSD->stream_active) {
+        pSD->stream_active = false;
+        sd_cmd(pSD, CMD12_STOP_TRANSMISSION, 0x0, false, 0);
+    }
+}
+
 #if 0
 static const char *cmd2str(const cmdSupported cmd) {
     switch (cmd) {
@@ -457,6 +498,11 @@ static int sd_cmd(sd_card_t *pSD, const cmdSupported cmd, uint32_t arg,
     int32_t status = SD_BLOCK_DEVICE_ERROR_NONE;
     uint32_t response;
 
+    // Any other command ends an open multi-block read first
+    if (CMD12_STOP_TRANSMISSION != cmd) {
+        sd_stream_stop(pSD);
+    }
+
     // No need to wait for card to be ready when sending the stop command
     if (CMD12_STOP_TRANSMISSION != cmd) {
         if (false == sd_wait_ready(pSD, SD_COMMAND_TIMEOUT)) {
@@ -843,6 +889,94 @@ static int sd_read_block(sd_card_t *pSD, uint8_t *buffer, uint32_t length) {
     return SD_BLOCK_DEVICE_ERROR_NONE;
 }
 
+#if SD_STREAMING_READS
+// Wait for the data start token by polling the SPI FIFO directly; the
+// DMA-backed sd_spi_write() costs a full DMA setup and IRQ per byte.
+static bool sd_wait_start_token_fast(sd_card_t *pSD) {
+    spi_inst_t *spi = pSD->spi->hw_inst;
+    absolute_time_t timeout_time = make_timeout_time_ms(SD_COMMAND_TIMEOUT);
+    uint8_t token;
+    do {
+        spi_read_blocking(spi, SPI_FILL_CHAR, &token, 1);
+        if (SPI_START_BLOCK == token) {
+            return true;
+        }
+        // A data error token ends the block early
+        if (!(token & ~SPI_DATA_READ_ERROR_MASK)) {
+            DBG_PRINTF("%s: data error token 0x%02x\r\n", __FUNCTION__, token);
+            return false;
+        }
+    } while (0 < absolute_time_diff_us(get_absolute_time(), timeout_time));
+    DBG_PRINTF("%s: timeout\r\n", __FUNCTION__);
+    return false;
+}
+
+// Receive one block of an open CMD18 transfer. The start token latency (Nac)
+// varies per block, so it is polled; data and CRC then arrive in one chained
+// DMA transfer.
+static int sd_read_block_stream(sd_card_t *pSD, uint8_t *buffer) {
+    uint8_t crc_rx[2];
+
+    if (!sd_wait_start_token_fast(pSD)) {
+        return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+    }
+    if (!spi_receive_block(pSD->spi, buffer, _block_size, crc_rx, sizeof crc_rx)) {
+        return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+    }
+
+#if SD_CRC_ENABLED
+    if (crc_on) {
+        const uint16_t crc = (crc_rx[0] << 8) | crc_rx[1];
+        const uint16_t crc_result = crc16((void *)buffer, _block_size);
+        if (crc_result != crc) {
+            DBG_PRINTF("%s: Invalid CRC received 0x%" PRIx16
+                       " result of computation 0x%" PRIx16 "\r\n",
+                       __FUNCTION__, crc, crc_result);
+            return SD_BLOCK_DEVICE_ERROR_CRC;
+        }
+    }
+#endif
+
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+
+// Sequential reads continue the open CMD18 transfer; anything else (or an
+// error) stops it with CMD12 and starts over at the requested block.
+static int in_sd_read_blocks_stream(sd_card_t *pSD, uint8_t *buffer,
+                                    uint64_t ulSectorNumber, uint32_t ulSectorCount) {
+    if (pSD->stream_active && pSD->stream_next_block != ulSectorNumber) {
+        sd_stream_stop(pSD);
+    }
+
+    if (!pSD->stream_active) {
+        // SDSC Card (CCS=0) uses byte unit address
+        // SDHC and SDXC Cards (CCS=1) use block unit address (512 Bytes unit)
+        const uint64_t addr = (SDCARD_V2HC == pSD->card_type) ? ulSectorNumber : ulSectorNumber * _block_size;
+        int status = sd_cmd(pSD, CMD18_READ_MULTIPLE_BLOCK, addr, false, 0);
+        if (SD_BLOCK_DEVICE_ERROR_NONE != status) {
+            return status;
+        }
+        pSD->stream_active = true;
+    }
+
+    for (uint32_t blockCnt = ulSectorCount; blockCnt; --blockCnt) {
+        int rd_status = sd_read_block_stream(pSD, buffer);
+        if (SD_BLOCK_DEVICE_ERROR_NONE != rd_status) {
+            sd_stream_stop(pSD);
+            return rd_status;
+        }
+        buffer += _block_size;
+    }
+
+    pSD->stream_next_block = ulSectorNumber + ulSectorCount;
+    // Don't let the card run past its last block
+    if (pSD->stream_next_block >= pSD->sectors) {
+        sd_stream_stop(pSD);
+    }
+    return SD_BLOCK_DEVICE_ERROR_NONE;
+}
+#endif
+
 static int in_sd_read_blocks(sd_card_t *pSD, uint8_t *buffer,
                              uint64_t ulSectorNumber, uint32_t ulSectorCount) {
     uint32_t blockCnt = ulSectorCount;
@@ -852,6 +986,10 @@ static int in_sd_read_blocks(sd_card_t *pSD, uint8_t *buffer,
     if (pSD->m_Status & (STA_NOINIT | STA_NODISK))
         return SD_BLOCK_DEVICE_ERROR_PARAMETER;
 
+#if SD_STREAMING_READS
+    return in_sd_read_blocks_stream(pSD, buffer, ulSectorNumber, ulSectorCount);
+#endif
+
     int status = SD_BLOCK_DEVICE_ERROR_NONE;
 
     uint64_t addr;
@@ -888,12 +1026,42 @@ static int in_sd_read_blocks(sd_card_t *pSD, uint8_t *buffer,
     return rd_status ? rd_status : status;
 }
 
+// Leaves the SPI bus alone when no stream is open, it may not be the bus in use
+void sd_read_stream_stop(sd_card_t *pSD) {
+    if (!pSD->stream_active) return;
+    sd_acquire(pSD);
+    sd_stream_stop(pSD);
+    sd_release(pSD);
+}
+
+// Must be called with the card acquired
+static bool in_sd_clock_step_down(sd_card_t *pSD) {
+    const uint current = pSD->spi->baud_rate;
+    if (current <= SD_CLOCK_FALLBACK_MIN_BAUD) return false;
+    // spi_set_baudrate() picks the fastest rate not above the request
+    uint lower = spi_set_baudrate(pSD->spi->hw_inst, current - 1);
+    if (lower < SD_CLOCK_FALLBACK_MIN_BAUD)
+        lower = spi_set_baudrate(pSD->spi->hw_inst, SD_CLOCK_FALLBACK_MIN_BAUD);
+    pSD->spi->baud_rate = lower;
+    pSD->clock_fallbacks++;
+    DBG_PRINTF("SD clock stepped down to %u Hz\r\n", lower);
+    return true;
+}
+
 int sd_read_blocks(sd_card_t *pSD, uint8_t *buffer, uint64_t ulSectorNumber,
                    uint32_t ulSectorCount) {
     sd_acquire(pSD);
     TRACE_PRINTF("sd_read_blocks(0x%p, 0x%llx, 0x%lx)\r\n", buffer,
                  ulSectorNumber, ulSectorCount);
     int status = in_sd_read_blocks(pSD, buffer, ulSectorNumber, ulSectorCount);
+#if SD_CLOCK_FALLBACK
+    for (int retry = 0; SD_BLOCK_DEVICE_ERROR_CRC == status && retry < SD_CLOCK_FALLBACK_RETRIES; retry++) {
+        pSD->crc_errors++;
+        in_sd_clock_step_down(pSD);
+        status = in_sd_read_blocks(pSD, buffer, ulSectorNumber, ulSectorCount);
+    }
+    if (SD_BLOCK_DEVICE_ERROR_CRC == status) pSD->crc_errors++;
+#endif
     sd_release(pSD);
     return status;
 }
@@ -1199,6 +1367,9 @@ static int sd_init(sd_card_t *pSD) {
     }
     // Initialize the member variables
     pSD->card_type = SDCARD_NONE;
+    pSD->stream_active = false;
+    pSD->crc_errors = 0;
+    pSD->clock_fallbacks = 0;
 
     sd_spi_acquire(pSD);
 
@@ -1247,6 +1418,7 @@ static bool sd_test_com(sd_card_t *pSD) {
 
     if (!(pSD->m_Status & STA_NOINIT)) {
         // SD card is currently initialized
+        sd_stream_stop(pSD);
 
         // Timeout of 0 means only check once
         if (sd_wait_ready(pSD, 0)) {
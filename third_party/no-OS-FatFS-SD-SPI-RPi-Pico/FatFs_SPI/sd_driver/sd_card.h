@@ -54,6 +54,14 @@ struct sd_card_t {
     mutex_t mutex;
     FATFS fatfs;
     bool mounted;
+    // Multi-block read streaming (SD_STREAMING_READS): while stream_active the
+    // card is still in CMD18 and will send stream_next_block next.
+    bool stream_active;
+    uint64_t stream_next_block;
+    // Diagnostics (SD_CLOCK_FALLBACK): data CRC errors seen by read_blocks and
+    // the SPI clock step-downs they caused.
+    uint32_t crc_errors;
+    uint32_t clock_fallbacks;
 
     int (*init)(sd_card_t *sd_card_p);
     int (*write_blocks)(sd_card_t *sd_card_p, const uint8_t *buffer,
@@ -92,6 +100,7 @@ uint64_t sd_sectors(sd_card_t *pSD);
 
 bool sd_init_driver();
 bool sd_card_detect(sd_card_t *sd_card_p);
+void sd_read_stream_stop(sd_card_t *sd_card_p);
 
 #ifdef __cplusplus
 }
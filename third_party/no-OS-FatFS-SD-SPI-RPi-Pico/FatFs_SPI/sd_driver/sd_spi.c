@@ -32,6 +32,8 @@ specific language governing permissions and limitations under the License.
 
 void sd_spi_go_high_frequency(sd_card_t *pSD) {
     uint actual = spi_set_baudrate(pSD->spi->hw_inst, pSD->spi->baud_rate);
+    // Keep the achieved rate so clock step-downs start from the real divider
+    pSD->spi->baud_rate = actual;
     TRACE_PRINTF("%s: Actual frequency: %lu\n", __FUNCTION__, (long)actual);
 }
 void sd_spi_go_low_frequency(sd_card_t *pSD) {
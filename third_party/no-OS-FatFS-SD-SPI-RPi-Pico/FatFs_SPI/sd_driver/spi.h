@@ -49,6 +49,12 @@ typedef struct {
     uint rx_dma;
     dma_channel_config tx_dma_cfg;
     dma_channel_config rx_dma_cfg;
+    // Block receive chain used by spi_receive_block(): data channel chains into
+    // a trailer channel so the block CRC lands outside the caller's buffer.
+    uint rx_block_dma;
+    uint rx_trailer_dma;
+    dma_channel_config rx_block_dma_cfg;
+    dma_channel_config rx_trailer_dma_cfg;
     irq_handler_t dma_isr; // Ignored: no longer used
     bool initialized;  
     semaphore_t sem;
@@ -60,6 +66,8 @@ extern "C" {
 #endif
   
 bool __not_in_flash_func(spi_transfer)(spi_t *pSPI, const uint8_t *tx, uint8_t *rx, size_t length);  
+bool __not_in_flash_func(spi_receive_block)(spi_t *pSPI, uint8_t *rx, size_t length, uint8_t *trailer,
+                                            size_t trailer_length);
 void spi_lock(spi_t *pSPI);
 void spi_unlock(spi_t *pSPI);
 bool my_spi_init(spi_t *pSPI);
@@ -142,7 +142,8 @@ DRESULT disk_ioctl(BYTE pdrv, /* Physical drive nmuber (0..) */
                                   // volume/partition to be created. It is
                                   // required when FF_USE_MKFS == 1.
             static LBA_t n;
-            n = sd_sectors(p_sd);
+            // Known after init; asking over SPI would break an SDIO-attached card
+            n = p_sd->sectors ? p_sd->sectors : sd_sectors(p_sd);
             *(LBA_t *)buff = n;
             if (!n) return RES_ERROR;
             return RES_OK;
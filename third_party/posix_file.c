@@ -35,6 +35,7 @@ static void posix_destroy(struct CueFile *file) {}
 
 static void posix_close(struct CueFile *file, struct CueScheduler *scheduler, void (*cb)(struct CueFile *, struct CueScheduler *)) {
     ff_fclose((FIL *)file->opaque);
+    file->opaque = NULL;
     File_schedule_close(file, scheduler, cb);
 }
 
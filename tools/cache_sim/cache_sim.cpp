@@ -0,0 +1,417 @@
+// Replays sector traces recorded with PICOSTATION_SECTOR_TRACE against other cache sizes, replacement policies
+// and prefetch depths.
+// Usage: cache_sim [--sizes 20,50,100] [--depths 0,4,8] trace.trc...
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "sector_trace.h"
+
+namespace Flags = picostation::sectortrace::Flags;
+
+struct Access {
+    int sector;
+    uint8_t flags;
+    size_t nextUse;  // Index of the next request for the same sector, SIZE_MAX if none
+};
+
+static constexpr size_t c_never = SIZE_MAX;
+
+// A cache of whole sectors. access() returns true on a hit; on a miss the sector is inserted.
+class Policy {
+  public:
+    virtual ~Policy() = default;
+    virtual const char *name() const = 0;
+    virtual bool contains(int sector) const = 0;
+    virtual bool access(const Access &access, bool demand) = 0;
+};
+
+// Round robin, as the firmware did before the stream ring
+class RoundRobin : public Policy {
+  public:
+    explicit RoundRobin(size_t size) : m_slots(size, -1) {}
+    const char *name() const override { return "round-robin"; }
+    bool contains(int sector) const override { return m_index.count(sector); }
+    bool access(const Access &access, bool) override {
+        if (contains(access.sector)) {
+            return true;
+        }
+        m_index.erase(m_slots[m_next]);
+        m_slots[m_next] = access.sector;
+        m_index.insert(access.sector);
+        m_next = (m_next + 1) % m_slots.size();
+        return false;
+    }
+
+  private:
+    std::vector<int> m_slots;
+    std::set<int> m_index;
+    size_t m_next = 0;
+};
+
+class LRU : public Policy {
+  public:
+    explicit LRU(size_t size) : m_size(size) {}
+    const char *name() const override { return "LRU"; }
+    bool contains(int sector) const override { return m_index.count(sector); }
+    bool access(const Access &access, bool) override {
+        auto it = m_index.find(access.sector);
+        if (it != m_index.end()) {
+            m_order.splice(m_order.begin(), m_order, it->second);
+            return true;
+        }
+        if (m_order.size() == m_size) {
+            m_index.erase(m_order.back());
+            m_order.pop_back();
+        }
+        m_order.push_front(access.sector);
+        m_index[access.sector] = m_order.begin();
+        return false;
+    }
+
+  private:
+    size_t m_size;
+    std::list<int> m_order;
+    std::unordered_map<int, std::list<int>::iterator> m_index;
+};
+
+class Clock : public Policy {
+  public:
+    explicit Clock(size_t size) : m_slots(size, -1), m_referenced(size, false) {}
+    const char *name() const override { return "CLOCK"; }
+    bool contains(int sector) const override { return m_index.count(sector); }
+    bool access(const Access &access, bool) override {
+        auto it = m_index.find(access.sector);
+        if (it != m_index.end()) {
+            m_referenced[it->second] = true;
+            return true;
+        }
+        while (m_referenced[m_hand]) {
+            m_referenced[m_hand] = false;
+            m_hand = (m_hand + 1) % m_slots.size();
+        }
+        m_index.erase(m_slots[m_hand]);
+        m_slots[m_hand] = access.sector;
+        m_index[access.sector] = m_hand;
+        m_hand = (m_hand + 1) % m_slots.size();
+        return false;
+    }
+
+  private:
+    std::vector<int> m_slots;
+    std::vector<bool> m_referenced;
+    std::unordered_map<int, size_t> m_index;
+    size_t m_hand = 0;
+};
+
+// Adaptive Replacement Cache (Megiddo and Modha): recency list T1 and frequency list T2, with ghost lists B1/B2
+// of recently evicted sectors steering the target size p of T1
+class ARC : public Policy {
+  public:
+    explicit ARC(size_t size) : m_size(size) {}
+    const char *name() const override { return "ARC"; }
+    bool contains(int sector) const override { return m_t1.contains(sector) || m_t2.contains(sector); }
+    bool access(const Access &access, bool) override {
+        const int x = access.sector;
+        if (m_t1.contains(x) || m_t2.contains(x)) {
+            m_t1.erase(x);
+            m_t2.erase(x);
+            m_t2.pushFront(x);
+            return true;
+        }
+        if (m_b1.contains(x)) {
+            m_p = std::min<size_t>(m_size, m_p + std::max<size_t>(1, m_b2.size() / m_b1.size()));
+            replace(false);
+            m_b1.erase(x);
+            m_t2.pushFront(x);
+            return false;
+        }
+        if (m_b2.contains(x)) {
+            const size_t delta = std::max<size_t>(1, m_b1.size() / m_b2.size());
+            m_p = m_p > delta ? m_p - delta : 0;
+            replace(true);
+            m_b2.erase(x);
+            m_t2.pushFront(x);
+            return false;
+        }
+        const size_t l1 = m_t1.size() + m_b1.size();
+        const size_t total = l1 + m_t2.size() + m_b2.size();
+        if (l1 == m_size) {
+            if (m_t1.size() < m_size) {
+                m_b1.popBack();
+                replace(false);
+            } else {
+                m_t1.popBack();
+            }
+        } else if (total >= m_size) {
+            if (total == 2 * m_size) {
+                m_b2.popBack();
+            }
+            replace(false);
+        }
+        m_t1.pushFront(x);
+        return false;
+    }
+
+  private:
+    class List {
+      public:
+        bool contains(int x) const { return m_index.count(x); }
+        size_t size() const { return m_order.size(); }
+        void pushFront(int x) {
+            m_order.push_front(x);
+            m_index[x] = m_order.begin();
+        }
+        void erase(int x) {
+            auto it = m_index.find(x);
+            if (it != m_index.end()) {
+                m_order.erase(it->second);
+                m_index.erase(it);
+            }
+        }
+        int popBack() {
+            const int x = m_order.back();
+            erase(x);
+            return x;
+        }
+
+      private:
+        std::list<int> m_order;
+        std::unordered_map<int, std::list<int>::iterator> m_index;
+    };
+
+    void replace(bool inB2) {
+        if (m_t1.size() > 0 && (m_t1.size() > m_p || (inB2 && m_t1.size() == m_p))) {
+            m_b1.pushFront(m_t1.popBack());
+        } else if (m_t2.size() > 0) {
+            m_b2.pushFront(m_t2.popBack());
+        } else if (m_t1.size() > 0) {
+            m_b1.pushFront(m_t1.popBack());
+        }
+    }
+
+    size_t m_size;
+    size_t m_p = 0;
+    List m_t1, m_t2, m_b1, m_b2;
+};
+
+// Belady's optimum: evict the sector needed furthest in the future. Needs the whole trace, so it is the upper
+// bound the others are measured against.
+class Optimal : public Policy {
+  public:
+    explicit Optimal(size_t size) : m_size(size) {}
+    const char *name() const override { return "optimal"; }
+    bool contains(int sector) const override { return m_nextUse.count(sector); }
+    bool access(const Access &access, bool) override {
+        auto it = m_nextUse.find(access.sector);
+        const bool hit = it != m_nextUse.end();
+        if (hit) {
+            m_byNextUse.erase({it->second, access.sector});
+        } else if (m_nextUse.size() == m_size) {
+            auto victim = std::prev(m_byNextUse.end());
+            m_nextUse.erase(victim->second);
+            m_byNextUse.erase(victim);
+        }
+        m_nextUse[access.sector] = access.nextUse;
+        m_byNextUse.insert({access.nextUse, access.sector});
+        return hit;
+    }
+
+  private:
+    size_t m_size;
+    std::unordered_map<int, size_t> m_nextUse;
+    std::set<std::pair<size_t, int>> m_byNextUse;
+};
+
+// The firmware's SectorCache: CLOCK main slots plus a round-robin ring for sequential streams
+class StreamRing : public Policy {
+  public:
+    static constexpr size_t c_streamSlots = 8;
+    static constexpr int c_streamRun = 16;
+
+    explicit StreamRing(size_t size)
+        : m_main(size > c_streamSlots ? size - c_streamSlots : 1), m_ring(std::min(size, c_streamSlots)) {}
+    const char *name() const override { return "clock+stream"; }
+    bool contains(int sector) const override { return m_main.contains(sector) || m_ring.contains(sector); }
+    bool access(const Access &access, bool demand) override {
+        if (demand) {
+            if (access.sector == m_lastSector + 1) {
+                m_runLength++;
+            } else if (access.sector != m_lastSector) {
+                m_runLength = 0;
+            }
+            m_lastSector = access.sector;
+        }
+        if (m_ring.contains(access.sector) && !m_main.contains(access.sector)) {
+            if (demand && m_runLength == 0) {
+                m_main.access(access, demand);  // Promoted, the copy left in the ring ages out
+            }
+            return true;
+        }
+        if (m_main.contains(access.sector)) {
+            return m_main.access(access, demand);
+        }
+        const bool streaming = m_runLength >= c_streamRun || !(access.flags & Flags::DATA);
+        return streaming ? m_ring.access(access, demand) : m_main.access(access, demand);
+    }
+
+  private:
+    Clock m_main;
+    RoundRobin m_ring;
+    int m_lastSector = -2;
+    int m_runLength = 0;
+};
+
+struct Result {
+    size_t demands = 0;
+    size_t hits = 0;
+    size_t reads = 0;  // SD reads, prefetches included
+};
+
+static std::vector<Access> loadTrace(const char *path) {
+    std::vector<Access> accesses;
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "%s: can't open\n", path);
+        return accesses;
+    }
+    picostation::sectortrace::Header header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, "PSTR", 4) != 0 ||
+        header.version != 1 || header.recordSize != sizeof(picostation::sectortrace::Record)) {
+        fprintf(stderr, "%s: not a sector trace\n", path);
+        fclose(file);
+        return accesses;
+    }
+    picostation::sectortrace::Record record;
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+        const uint8_t flags = record.sectorFlags >> 24;
+        if (!(flags & Flags::PREFETCH)) {  // The simulator issues its own read-ahead
+            accesses.push_back({(int)(record.sectorFlags & 0xFFFFFF), flags, c_never});
+        }
+    }
+    fclose(file);
+
+    std::unordered_map<int, size_t> next;
+    for (size_t i = accesses.size(); i-- > 0;) {
+        auto it = next.find(accesses[i].sector);
+        accesses[i].nextUse = it == next.end() ? c_never : it->second;
+        next[accesses[i].sector] = i;
+    }
+    return accesses;
+}
+
+// Read-ahead as I2S::start does it: after a seek, the sectors following the target
+static Result run(Policy &policy, const std::vector<Access> &accesses, int depth) {
+    // Next demand index per sector from a position, for the optimal policy's prefetched entries
+    std::unordered_map<int, std::vector<size_t>> uses;
+    if (depth > 0) {
+        for (size_t i = 0; i < accesses.size(); i++) {
+            uses[accesses[i].sector].push_back(i);
+        }
+    }
+
+    Result result;
+    int lastSector = -2;
+    for (size_t i = 0; i < accesses.size(); i++) {
+        const Access &access = accesses[i];
+        result.demands++;
+        if (policy.access(access, true)) {
+            result.hits++;
+        } else {
+            result.reads++;
+        }
+        if (depth > 0 && access.sector != lastSector + 1 && access.sector != lastSector) {
+            for (int d = 1; d <= depth; d++) {
+                const int sector = access.sector + d;
+                if (policy.contains(sector)) {
+                    continue;
+                }
+                size_t nextUse = c_never;
+                auto it = uses.find(sector);
+                if (it != uses.end()) {
+                    auto use = std::upper_bound(it->second.begin(), it->second.end(), i);
+                    if (use != it->second.end()) {
+                        nextUse = *use;
+                    }
+                }
+                policy.access({sector, access.flags, nextUse}, false);
+                result.reads++;
+            }
+        }
+        lastSector = access.sector;
+    }
+    return result;
+}
+
+static std::vector<int> parseList(const char *text) {
+    std::vector<int> values;
+    for (const char *p = text; *p;) {
+        values.push_back(atoi(p));
+        p = strchr(p, ',');
+        if (!p) {
+            break;
+        }
+        p++;
+    }
+    return values;
+}
+
+int main(int argc, char **argv) {
+    std::vector<int> sizes = {20, 50, 100};
+    std::vector<int> depths = {0, 4};
+    std::vector<const char *> traces;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--sizes") && i + 1 < argc) {
+            sizes = parseList(argv[++i]);
+        } else if (!strcmp(argv[i], "--depths") && i + 1 < argc) {
+            depths = parseList(argv[++i]);
+        } else {
+            traces.push_back(argv[i]);
+        }
+    }
+    if (traces.empty()) {
+        fprintf(stderr, "usage: %s [--sizes 20,50,100] [--depths 0,4,8] trace.trc...\n", argv[0]);
+        return 1;
+    }
+
+    for (const char *trace : traces) {
+        const std::vector<Access> accesses = loadTrace(trace);
+        if (accesses.empty()) {
+            continue;
+        }
+        size_t recordedHits = 0;
+        for (const Access &access : accesses) {
+            recordedHits += (access.flags & Flags::HIT) != 0;
+        }
+        printf("%s: %zu requests, %.1f%% hits as recorded\n", trace, accesses.size(),
+               100.0 * recordedHits / accesses.size());
+        printf("%-14s %6s %6s %8s %10s\n", "policy", "size", "depth", "hit %", "SD reads");
+        for (int size : sizes) {
+            for (int depth : depths) {
+                std::unique_ptr<Policy> policies[] = {
+                    std::make_unique<RoundRobin>(size), std::make_unique<LRU>(size),
+                    std::make_unique<Clock>(size),      std::make_unique<ARC>(size),
+                    std::make_unique<StreamRing>(size), std::make_unique<Optimal>(size),
+                };
+                for (auto &policy : policies) {
+                    const Result result = run(*policy, accesses, depth);
+                    printf("%-14s %6d %6d %8.1f %10zu\n", policy->name(), size, depth,
+                           100.0 * result.hits / result.demands, result.reads);
+                }
+            }
+        }
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,41 @@
+// Directory sectors re-read around a long sequential run must stay in the main slots: the run goes through the
+// stream ring and the directory's second pass costs no SD reads.
+#include <stdio.h>
+#include <string.h>
+
+#include "disc_image.h"
+#include "host.h"
+#include "images.h"
+#include "sector_cache.h"
+
+int main() {
+    const images::Bytes track = images::track(0, 3000, 0);
+    images::write("data.bin", track);
+    images::write("data.cue", std::string("FILE \"data.bin\" BINARY\n  TRACK 01 MODE1/2352\n    INDEX 01 00:00:00\n"));
+
+    static picostation::DiscImage image;
+    CHECK(image.load("./data.cue") == FR_OK);
+    static picostation::SectorCache cache(&image);
+    const int base = c_leadIn + c_preGap;
+    image.generateSubQ(base + 16);  // The current track is data
+
+    for (int pass = 0; pass < 3; pass++) {
+        for (int sector = 16; sector < 24; sector++) {
+            cache.get(base + sector);
+        }
+    }
+    for (int sector = 500; sector < 2500; sector++) {
+        cache.get(base + sector);
+    }
+    const picostation::SectorCache::Stats run = cache.getStats();
+    const uint32_t reads = host::readCount();
+    for (int sector = 16; sector < 24; sector++) {
+        const uint16_t *data = cache.get(base + sector);
+        CHECK(memcmp(data, &track[size_t(sector) * 2352], 2352) == 0);
+    }
+    CHECK(host::readCount() == reads);
+    CHECK(run.streamed >= 2000 - picostation::SectorCache::c_streamRun);
+    printf("cache: %u hits, %u misses, %u streamed, %u reads for the second directory pass\n", (unsigned)run.hits,
+           (unsigned)run.misses, (unsigned)run.streamed, (unsigned)(host::readCount() - reads));
+    return g_checkFailures ? 1 : 0;
+}
@@ -0,0 +1,97 @@
+// The I2S sample copy must produce the same words as the original per-sample loop, and the audio meters the largest
+// absolute sample of each channel. Prints the host time of both loops, which only compares them with each other:
+// the M0+ has no vector unit and a different memory system.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "host.h"
+#include "images.h"
+#include "sample_copy.h"
+
+// The loop the I2S code ran before the meters, with the data/audio test made for every sample
+static void __attribute__((noinline)) copyOriginal(uint32_t *samples, const uint16_t *sector, const uint16_t *key,
+                                                   const bool isData) {
+    for (size_t i = 0; i < c_cdSamplesSize * 2; i++) {
+        uint32_t i2s_data;
+        if (isData) {
+            i2s_data = (sector[i] ^ key[i]) << 8;
+        } else {
+            i2s_data = (sector[i]) << 8;
+        }
+        if (i2s_data & 0x100) {
+            i2s_data |= 0xFF;
+        }
+        samples[i] = i2s_data;
+    }
+}
+
+static void __attribute__((noinline)) copyFused(uint32_t *samples, const uint16_t *sector, const uint16_t *key,
+                                                const bool isData, int32_t *peakLeft, int32_t *peakRight) {
+    if (isData) {
+        picostation::samplecopy::copyData(samples, sector, key);
+    } else {
+        picostation::samplecopy::copyAudio(samples, sector, peakLeft, peakRight);
+    }
+}
+
+int main() {
+    static constexpr int c_sectors = 64;
+    static constexpr int c_passes = 2000;
+    static constexpr size_t c_words = c_cdSamplesSize * 2;
+    std::vector<uint16_t> sectors(c_sectors * c_words);
+    images::fill(reinterpret_cast<uint8_t *>(sectors.data()), sectors.size() * 2);
+    sectors[5 * c_words + 2] = 0x8000;  // -32768, whose magnitude doesn't fit the sample
+    uint16_t key[c_words];
+    images::fill(reinterpret_cast<uint8_t *>(key), sizeof(key));
+
+    static uint32_t expected[c_words];
+    static uint32_t samples[c_words];
+    int wrong = 0;
+    for (int s = 0; s < c_sectors; s++) {
+        const uint16_t *sector = &sectors[s * c_words];
+        for (const bool isData : {true, false}) {
+            int32_t peakLeft = -1;
+            int32_t peakRight = -1;
+            copyOriginal(expected, sector, key, isData);
+            copyFused(samples, sector, key, isData, &peakLeft, &peakRight);
+            wrong += memcmp(expected, samples, sizeof(samples)) != 0;
+            if (!isData) {
+                int32_t left = 0;
+                int32_t right = 0;
+                for (size_t i = 0; i < c_words; i += 2) {
+                    left = std::max(left, abs((int16_t)sector[i]));
+                    right = std::max(right, abs((int16_t)sector[i + 1]));
+                }
+                wrong += peakLeft != left || peakRight != right;
+            }
+        }
+    }
+    CHECK(wrong == 0);
+
+    auto time = [&](auto copy) {
+        const auto start = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < c_passes; pass++) {
+            for (int s = 0; s < c_sectors; s++) {
+                copy(&sectors[s * c_words], s & 1);
+            }
+        }
+        const auto ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        return double(ns) / (c_passes * c_sectors);
+    };
+    int32_t peakLeft;
+    int32_t peakRight;
+    const double originalNs = time([&](const uint16_t *sector, bool isData) {
+        copyOriginal(samples, sector, key, isData);
+    });
+    const double fusedNs = time([&](const uint16_t *sector, bool isData) {
+        copyFused(samples, sector, key, isData, &peakLeft, &peakRight);
+    });
+    printf("copy: %.0f ns per sector for the original loop, %.0f ns with the meters, on the host\n", originalNs,
+           fusedNs);
+    return g_checkFailures ? 1 : 0;
+}
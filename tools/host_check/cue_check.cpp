@@ -0,0 +1,61 @@
+// A 99-FILE sheet must parse to the same layout on every load, with every scheduler closure from the pool.
+// Prints the closure counts and the host parse time, which is stdio bound and says nothing about the device.
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "disc_image.h"
+#include "host.h"
+#include "images.h"
+
+int main() {
+    std::string cue;
+    int sectors = 0;
+    int firsts[99];
+    for (int i = 0; i < 99; i++) {
+        const int count = 20 + i;
+        images::Bytes bytes(size_t(count) * 2352);
+        for (int j = 0; j < count; j++) {
+            bytes[size_t(j) * 2352] = i;  // File and sector in each sector's first bytes
+            bytes[size_t(j) * 2352 + 1] = j;
+        }
+        char name[16];
+        snprintf(name, sizeof(name), "t%02d.bin", i + 1);
+        images::write(name, bytes);
+        char line[128];
+        snprintf(line, sizeof(line), "FILE \"%s\" BINARY\n  TRACK %02d AUDIO\n    INDEX 01 00:00:00\n", name, i + 1);
+        cue += line;
+        firsts[i] = sectors;
+        sectors += count;
+    }
+    images::write("tracks.cue", cue);
+
+    // Reloads free the previous image's files first, a leak would show up under LeakSanitizer
+    for (int pass = 0; pass < 3; pass++) {
+        static picostation::DiscImage image;
+        Scheduler_resetClosureStats();
+        const auto start = std::chrono::steady_clock::now();
+        CHECK(image.load("./tracks.cue") == FR_OK);
+        const auto us =
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        const CueClosureStats stats = Scheduler_getClosureStats();
+        CHECK(stats.heapFallbacks == 0);
+        CHECK(stats.peakInUse <= CUE_CLOSURE_POOL_SIZE);
+        CHECK(image.sectorCount() == sectors);
+
+        int wrong = 0;
+        uint8_t buffer[2352];
+        for (int i = 0; i < 99; i++) {
+            for (const int index : {0, 19 + i}) {
+                picostation::DiscImage::Location location;
+                wrong += !image.locate(firsts[i] + index, &location) || location.file != i || location.index != index;
+                wrong += !image.readData(buffer, firsts[i] + index) || buffer[0] != i || buffer[1] != index;
+            }
+        }
+        CHECK(wrong == 0);
+        printf("cue pass %d: %u closures, %u from the heap, peak %u, parsed in %lld us on the host\n", pass,
+               (unsigned)stats.allocations, (unsigned)stats.heapFallbacks, (unsigned)stats.peakInUse, (long long)us);
+    }
+    return g_checkFailures ? 1 : 0;
+}
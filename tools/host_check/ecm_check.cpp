@@ -0,0 +1,124 @@
+// An image with one ECM-encoded file per track must read back byte for byte, in order and at random. So must a
+// stream laid out byte for byte the way the ecm 1.0 tool writes one, which images::encodeEcm plays no part in.
+#include <stdio.h>
+#include <string.h>
+
+#include "disc_image.h"
+#include "host.h"
+#include "images.h"
+
+// The ecm tool's trailer: the EDC of the whole decoded file
+static uint32_t imageEdc(const images::Bytes &data) {
+    uint32_t edc = 0;
+    for (const uint8_t byte : data) {
+        edc ^= byte;
+        for (int bit = 0; bit < 8; bit++) {
+            edc = (edc >> 1) ^ ((edc & 1) ? 0xD8018001 : 0);
+        }
+    }
+    return edc;
+}
+
+// 40 mode 1 sectors, a mode 2 form 1 and a form 2 sector, then one the tool can't encode. Record headers are
+// written out as the tool's write_type_count produces them: type in bits 0-1, count - 1 from bit 2 on, 7 more
+// bits per continuation byte.
+static void checkReferenceStream() {
+    images::Bytes raw;
+    for (int lba = 0; lba < 43; lba++) {
+        uint8_t sector[2352];
+        images::sector(sector, lba, lba < 40 ? 0 : lba - 39);
+        raw.insert(raw.end(), sector, sector + sizeof(sector));
+    }
+    auto append = [](images::Bytes &out, const uint8_t *data, const size_t length) {
+        out.insert(out.end(), data, data + length);
+    };
+
+    images::Bytes ecm = {'E', 'C', 'M', 0x00};
+    ecm.insert(ecm.end(), {0x9D, 0x01});  // Mode 1, 40 sectors
+    for (int lba = 0; lba < 40; lba++) {
+        append(ecm, &raw[lba * 2352 + 12], 3);
+        append(ecm, &raw[lba * 2352 + 16], 2048);
+    }
+    ecm.push_back(0x3C);  // 16 bytes as is, the mode 2 sync and header
+    append(ecm, &raw[40 * 2352], 16);
+    ecm.push_back(0x02);  // Mode 2 form 1, 1 sector
+    append(ecm, &raw[40 * 2352 + 20], 4 + 2048);  // The second copy of the subheader and the data
+    ecm.push_back(0x3C);
+    append(ecm, &raw[41 * 2352], 16);
+    ecm.push_back(0x03);  // Mode 2 form 2, 1 sector
+    append(ecm, &raw[41 * 2352 + 20], 4 + 2324);
+    ecm.insert(ecm.end(), {0xBC, 0x49});  // 2352 bytes as is
+    append(ecm, &raw[42 * 2352], 2352);
+    ecm.insert(ecm.end(), {0xFC, 0xFF, 0xFF, 0xFF, 0x3F});  // End of stream, a count of 0
+    const uint32_t edc = imageEdc(raw);
+    ecm.insert(ecm.end(), {uint8_t(edc), uint8_t(edc >> 8), uint8_t(edc >> 16), uint8_t(edc >> 24)});
+
+    images::write("ref.bin.ecm", ecm);
+    remove("ref.bin");
+    remove("ref.bin.ecm.idx");
+    images::write("ref.cue", std::string("FILE \"ref.bin\" BINARY\n  TRACK 01 MODE2/2352\n    INDEX 01 00:00:00\n"));
+    static picostation::DiscImage image;
+    CHECK(image.load("./ref.cue") == FR_OK);
+    CHECK(image.sectorCount() == 43);
+    int mismatches = 0;
+    uint8_t buffer[2352];
+    for (int lba = 0; lba < 43; lba++) {
+        CHECK(image.readData(buffer, lba));
+        mismatches += memcmp(buffer, &raw[lba * 2352], 2352) != 0;
+    }
+    CHECK(mismatches == 0);
+    printf("ecm reference stream: %zu bytes, %d mismatches\n", ecm.size(), mismatches);
+}
+
+int main() {
+    const images::Bytes tracks[] = {images::track(0, 300, 0), images::track(300, 200, 1), images::track(500, 100, 3),
+                                    images::track(600, 1200, 1)};
+    std::string cue;
+    int lba = 0;
+    for (int i = 0; i < 4; i++) {
+        const std::string name = "ecm" + std::to_string(i + 1) + ".bin";
+        images::write(name + ".ecm", images::encodeEcm(tracks[i]));
+        remove(name.c_str());
+        remove((name + ".ecm.idx").c_str());
+        char line[128];
+        snprintf(line, sizeof(line), "FILE \"%s\" BINARY\n  TRACK %02d %s\n    INDEX 01 00:00:00\n", name.c_str(),
+                 i + 1, i == 2 ? "AUDIO" : (i == 0 ? "MODE1/2352" : "MODE2/2352"));
+        cue += line;
+        lba += tracks[i].size() / 2352;
+    }
+    images::write("ecm.cue", cue);
+
+    // Second pass loads the .idx files the first one wrote
+    for (int pass = 0; pass < 2; pass++) {
+        static picostation::DiscImage image;
+        CHECK(image.load("./ecm.cue") == FR_OK);
+        CHECK(image.sectorCount() == lba);
+
+        uint8_t buffer[2352];
+        auto expected = [&](int sector) -> const uint8_t * {
+            for (const images::Bytes &track : tracks) {
+                const int count = track.size() / 2352;
+                if (sector < count) {
+                    return &track[size_t(sector) * 2352];
+                }
+                sector -= count;
+            }
+            return nullptr;
+        };
+        // Gaps between tracks are generated, readData addresses sectors by where the files put them
+        int mismatches = 0;
+        for (int sector = 0; sector < lba; sector++) {
+            CHECK(image.readData(buffer, sector));
+            mismatches += memcmp(buffer, expected(sector), 2352) != 0;
+        }
+        for (int i = 0; i < 2000; i++) {
+            const int sector = (images::random8() << 8 | images::random8()) % lba;
+            CHECK(image.readData(buffer, sector));
+            mismatches += memcmp(buffer, expected(sector), 2352) != 0;
+        }
+        CHECK(mismatches == 0);
+        printf("ecm pass %d: %d mismatches\n", pass, mismatches);
+    }
+    checkReferenceStream();
+    return g_checkFailures ? 1 : 0;
+}
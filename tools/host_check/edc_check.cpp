@@ -0,0 +1,99 @@
+// The EDC and P/Q parity of a mode 1 and a mode 2 form 1 sector must match known answers. edc_reference.py prints
+// the expected bytes from the standard's own formulation of ECMA-130 annexes A and B, which shares nothing with the
+// table driven loops in src/edc_ecc.cpp.
+#include <stdio.h>
+#include <string.h>
+
+#include "edc_ecc.h"
+#include "host.h"
+
+// Mode 1 at 00:02:16, user byte i is i * 37 + 11. Sector bytes 0x810 on: EDC, the zero area, P and Q parity.
+static const uint8_t c_mode1Tail[2352 - 0x810] = {
+    0x27, 0x6C, 0xB9, 0x95, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x25, 0xB5, 0xCC, 0x6B, 0x32, 0x92, 0x0E, 0xA1, 0xB7, 0x40, 0xC6, 0x0B,
+    0xFD, 0xD2, 0x4A, 0x20, 0x4C, 0x8E, 0x74, 0x65, 0x4C, 0x7C, 0xB0, 0x4B,
+    0x00, 0xE4, 0x04, 0xAC, 0x1E, 0x37, 0x04, 0xA8, 0xE6, 0x13, 0xE4, 0x44,
+    0x40, 0xA7, 0x64, 0x38, 0x16, 0x88, 0x34, 0xC5, 0x70, 0xEC, 0x0B, 0xC6,
+    0x70, 0x28, 0x33, 0x08, 0x00, 0x49, 0xE1, 0xFE, 0xAA, 0xE5, 0x73, 0x37,
+    0x81, 0x4D, 0x2F, 0x9A, 0xC4, 0x8D, 0xDD, 0xBA, 0xEA, 0x04, 0x45, 0xC9,
+    0x0D, 0xBA, 0xE2, 0x98, 0x20, 0xA4, 0x0E, 0x43, 0xC3, 0xF8, 0x53, 0xC4,
+    0x1E, 0xFE, 0x12, 0x7B, 0xCB, 0x4C, 0x12, 0xA2, 0x1E, 0x01, 0x37, 0x70,
+    0xD6, 0x0B, 0x1D, 0xE2, 0x1A, 0x80, 0x8C, 0xBE, 0x84, 0xA5, 0xAC, 0x2C,
+    0xC0, 0x6B, 0x00, 0xF4, 0xF4, 0x2C, 0x7E, 0x27, 0x74, 0xC8, 0xA6, 0xC3,
+    0x34, 0x04, 0x20, 0xD7, 0x74, 0x58, 0x96, 0x78, 0x24, 0xC5, 0x50, 0x9C,
+    0x5B, 0x26, 0xB0, 0xD8, 0x03, 0xC8, 0xA0, 0x19, 0xD1, 0x1E, 0xAA, 0xF5,
+    0x43, 0xB7, 0x21, 0x5D, 0x1F, 0xBA, 0x04, 0x5D, 0x8D, 0xFA, 0xCA, 0x34,
+    0x55, 0x69, 0x8D, 0x8A, 0xDE, 0xC4, 0xAC, 0x7B, 0x41, 0x27, 0x6A, 0xC6,
+    0x10, 0xDC, 0x03, 0x8C, 0xD2, 0x75, 0xEE, 0x66, 0x10, 0xD3, 0x76, 0x29,
+    0x6D, 0x97, 0xDF, 0x98, 0x48, 0x92, 0x13, 0xD2, 0xB7, 0xB4, 0x90, 0x9C,
+    0x99, 0xE3, 0xF8, 0xD2, 0x0F, 0x9C, 0x4C, 0x36, 0x9D, 0xAD, 0x9D, 0x66,
+    0xEF, 0xDB, 0xE1, 0x3E, 0xE1, 0xCF, 0xC9, 0x23, 0x8C, 0x33, 0xCA, 0x34,
+    0xBF, 0xB4, 0xD8, 0x2B, 0x88, 0xC8, 0x39, 0x87, 0xED, 0x2B, 0xA0, 0xB2,
+    0x2C, 0xE5, 0xD3, 0x76, 0x0C, 0xE2, 0xA0, 0x9A, 0x73, 0x19, 0x13, 0xFD,
+    0x48, 0x45, 0xD6, 0xB3, 0x3C, 0x74, 0x63, 0x7D, 0x39, 0xFF, 0x47, 0x30,
+    0xF9, 0xC4, 0x2C, 0xEA, 0xBF, 0x11, 0x3D, 0x9C, 0xFC, 0x52, 0xE0, 0x33,
+    0xCC, 0x6B, 0x04, 0x45, 0x11, 0x85, 0x1C, 0x5F, 0x60, 0x5A, 0x2F, 0xCA,
+};
+
+// Mode 2 form 1 at 00:02:17, subheader 01 02 08 00, user byte i is i * 53 + 5. Sector bytes 0x818 on: EDC, P and
+// Q parity, the latter two computed with a zero header.
+static const uint8_t c_form1Tail[2352 - 0x818] = {
+    0x92, 0x03, 0xF8, 0x66, 0xBE, 0xEE, 0x88, 0x9E, 0xC2, 0x22, 0x64, 0xEE,
+    0xD7, 0x73, 0xFD, 0x1D, 0xC1, 0xA3, 0xF9, 0x7C, 0x54, 0x42, 0xB2, 0x51,
+    0x79, 0xFD, 0x9D, 0x70, 0x10, 0x21, 0xD1, 0xD7, 0x67, 0x71, 0x69, 0xC0,
+    0xFD, 0x25, 0x91, 0x1D, 0x15, 0xEB, 0x93, 0x2C, 0x25, 0x39, 0xF0, 0x0F,
+    0x2F, 0x6B, 0x11, 0xE4, 0x02, 0xF3, 0xAE, 0x01, 0x23, 0x14, 0x72, 0x89,
+    0x84, 0xDD, 0x22, 0x88, 0x93, 0x5A, 0x76, 0x4E, 0x4E, 0x08, 0xB8, 0x84,
+    0x7F, 0x4A, 0x6A, 0x1B, 0x5C, 0x23, 0x38, 0x6E, 0xB7, 0x9C, 0xA0, 0x3E,
+    0x52, 0xAD, 0xE3, 0x58, 0x7E, 0xBD, 0x27, 0x50, 0x9B, 0xA6, 0x4E, 0x92,
+    0x6B, 0xC2, 0x57, 0xD7, 0x0E, 0x3D, 0xB1, 0x03, 0x79, 0xCC, 0xE4, 0xC2,
+    0x12, 0x21, 0x89, 0x9D, 0x5D, 0xC0, 0xC0, 0xE1, 0xF1, 0x07, 0x77, 0x91,
+    0x69, 0xD0, 0xED, 0x25, 0xB1, 0x0D, 0xC5, 0x8B, 0x53, 0x7C, 0xD5, 0x79,
+    0x50, 0xBF, 0x9F, 0x8B, 0x91, 0x14, 0x72, 0x73, 0xCE, 0xB1, 0x93, 0xB4,
+    0xB2, 0xF9, 0x54, 0x9D, 0xC2, 0xD8, 0x83, 0x7A, 0x76, 0x5E, 0x5E, 0x08,
+    0xD8, 0x94, 0x2F, 0x6A, 0x2A, 0x4B, 0xEC, 0x63, 0xD8, 0x1E, 0x47, 0x3C,
+    0x20, 0x8E, 0xE2, 0x2D, 0xD4, 0x91, 0x99, 0x9F, 0x19, 0xB3, 0x7E, 0xE6,
+    0x6A, 0xFA, 0x48, 0x66, 0xD0, 0x5B, 0x46, 0xE3, 0xD9, 0x3F, 0xFA, 0x8A,
+    0x50, 0x4D, 0x84, 0x56, 0x8A, 0x98, 0x57, 0x4E, 0x1B, 0x18, 0xEB, 0xCE,
+    0xB6, 0x92, 0xB0, 0x78, 0x9B, 0xCF, 0x2F, 0xE9, 0xD3, 0x8D, 0x58, 0x24,
+    0x49, 0x0F, 0xCF, 0x1E, 0x0B, 0x2D, 0xCF, 0xCE, 0x31, 0x03, 0x43, 0x4B,
+    0x11, 0xCD, 0x7A, 0x2D, 0xED, 0x1B, 0x54, 0x8A, 0xE0, 0x47, 0x7F, 0xC2,
+    0xCE, 0x3E, 0x52, 0xBE, 0xF5, 0x21, 0x35, 0xB0, 0x97, 0xEF, 0xE8, 0x2B,
+    0x8C, 0xBA, 0x2E, 0x91, 0xDB, 0xF0, 0xDE, 0xA4, 0xB1, 0x83, 0x5A, 0xCD,
+    0xB8, 0xE4, 0x77, 0x9C, 0x24, 0xC3, 0xD9, 0x89, 0x29, 0xFE, 0x63, 0x32,
+    0x30, 0xE8, 0x6A, 0x06,
+};
+
+int main() {
+    static uint8_t sector[2352];
+    memset(sector, 0xA5, sizeof(sector));  // The encoders must write every byte they own
+    for (int i = 0; i < 2048; i++) {
+        sector[16 + i] = i * 37 + 11;
+    }
+    picostation::edcecc::buildMode1(sector, 16);
+    CHECK(sector[12] == 0x00 && sector[13] == 0x02 && sector[14] == 0x16 && sector[15] == 0x01);
+    bool matches = memcmp(sector + 0x810, c_mode1Tail, sizeof(c_mode1Tail)) == 0;
+    CHECK(matches);
+    CHECK(picostation::edcecc::checkEDC(sector));
+    sector[16 + 1000] ^= 0x01;
+    CHECK(!picostation::edcecc::checkEDC(sector));
+    printf("edc mode 1: %s\n", matches ? "matches" : "differs");
+
+    memset(sector, 0xA5, sizeof(sector));
+    const uint8_t subheader[4] = {0x01, 0x02, 0x08, 0x00};
+    memcpy(sector + 16, subheader, 4);
+    memcpy(sector + 20, subheader, 4);
+    for (int i = 0; i < 2048; i++) {
+        sector[24 + i] = i * 53 + 5;
+    }
+    picostation::edcecc::buildMode2(sector, 17);
+    picostation::edcecc::encodeMode2Form1(sector);
+    CHECK(sector[12] == 0x00 && sector[13] == 0x02 && sector[14] == 0x17 && sector[15] == 0x02);
+    matches = memcmp(sector + 0x818, c_form1Tail, sizeof(c_form1Tail)) == 0;
+    CHECK(matches);
+    CHECK(picostation::edcecc::checkEDC(sector));
+    sector[24 + 1000] ^= 0x01;
+    CHECK(!picostation::edcecc::checkEDC(sector));
+    printf("edc mode 2 form 1: %s\n", matches ? "matches" : "differs");
+    return g_checkFailures ? 1 : 0;
+}
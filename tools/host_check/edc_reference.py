@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+# Prints the known answer tables in edc_check.cpp. ECMA-130 annexes A and B written the way the standard states
+# them: the EDC as a division by its 32-bit polynomial and the P and Q parity solved from the parity check matrices
+# over the sector's 16-bit words. Slow, and shares nothing with the table driven code in src/edc_ecc.cpp.
+# Usage: tools/host_check/edc_reference.py
+
+
+def gf_mul(a, b):
+    # GF(2^8) with x^8 + x^4 + x^3 + x^2 + 1
+    result = 0
+    while b:
+        if b & 1:
+            result ^= a
+        a <<= 1
+        if a & 0x100:
+            a ^= 0x11D
+        b >>= 1
+    return result
+
+
+def gf_pow(exponent):
+    result = 1
+    for _ in range(exponent):
+        result = gf_mul(result, 2)
+    return result
+
+
+def gf_inverse(a):
+    return next(x for x in range(1, 256) if gf_mul(a, x) == 1)
+
+
+def poly_mul(a, b):
+    result = 0
+    while b:
+        if b & 1:
+            result ^= a
+        a <<= 1
+        b >>= 1
+    return result
+
+
+# (x^16 + x^15 + x^2 + 1)(x^16 + x^2 + x + 1)
+EDC_POLY = poly_mul(1 << 16 | 1 << 15 | 1 << 2 | 1, 1 << 16 | 1 << 2 | 1 << 1 | 1)
+
+
+def edc(data):
+    # Each byte goes in least significant bit first, the parity bit for x^31 is stored first
+    remainder = 0
+    bits = [(byte >> k) & 1 for byte in data for k in range(8)] + [0] * 32
+    for bit in bits:
+        remainder = remainder << 1 | bit
+        if remainder >> 32:
+            remainder ^= EDC_POLY
+    return sum(1 << k for k in range(32) if remainder >> (31 - k) & 1)
+
+
+def parity(vector, n):
+    # H = [[1, ..., 1], [a^(n-1), ..., a^0]], the two parity symbols end the vector
+    s0 = 0
+    s1 = 0
+    for i, value in enumerate(vector):
+        s0 ^= value
+        s1 ^= gf_mul(gf_pow(n - 1 - i), value)
+    p0 = gf_mul(s0 ^ s1, gf_inverse(3))
+    return p0, s0 ^ p0
+
+
+def rspc(sector):
+    # Word w of the matrix starts at byte 12, its MSB plane is the first byte
+    def at(word, plane):
+        return 12 + 2 * word + plane
+
+    for plane in range(2):
+        for n in range(43):
+            p0, p1 = parity([sector[at(43 * m + n, plane)] for m in range(24)], 26)
+            sector[at(43 * 24 + n, plane)] = p0
+            sector[at(43 * 25 + n, plane)] = p1
+    for plane in range(2):
+        for n in range(26):
+            q0, q1 = parity([sector[at((44 * m + 43 * n) % 1118, plane)] for m in range(43)], 45)
+            sector[at(1118 + n, plane)] = q0
+            sector[at(1118 + 26 + n, plane)] = q1
+
+
+def put_edc(sector, offset, value):
+    sector[offset:offset + 4] = value.to_bytes(4, "little")
+
+
+def mode1():
+    sector = bytearray(2352)
+    sector[1:11] = b"\xff" * 10
+    sector[12:16] = bytes([0x00, 0x02, 0x16, 0x01])
+    sector[16:16 + 2048] = bytes((i * 37 + 11) & 0xFF for i in range(2048))
+    put_edc(sector, 0x810, edc(sector[:0x810]))
+    rspc(sector)
+    return sector
+
+
+def mode2_form1():
+    sector = bytearray(2352)
+    sector[1:11] = b"\xff" * 10
+    sector[16:24] = bytes([0x01, 0x02, 0x08, 0x00]) * 2
+    sector[24:24 + 2048] = bytes((i * 53 + 5) & 0xFF for i in range(2048))
+    put_edc(sector, 0x818, edc(sector[16:0x818]))
+    rspc(sector)  # With the header still zero
+    sector[12:16] = bytes([0x00, 0x02, 0x17, 0x02])
+    return sector
+
+
+def table(name, data):
+    print("static const uint8_t %s[2352 - 0x%X] = {" % (name, 2352 - len(data)))
+    for i in range(0, len(data), 12):
+        print("    " + " ".join("0x%02X," % x for x in data[i:i + 12]))
+    print("};")
+
+
+if __name__ == "__main__":
+    table("c_mode1Tail", mode1()[0x810:])
+    table("c_form1Tail", mode2_form1()[0x818:])
@@ -0,0 +1,96 @@
+// FLAC tracks must read back as the PCM they were encoded from, in order and at random. Seeks start from the
+// SEEKTABLE or probed slots and stay bounded, and a seek that runs past the read deadline finishes on later reads.
+// A frame whose CRC-16 does not match must fail its reads rather than play.
+#include <stdio.h>
+#include <string.h>
+
+#include "disc_image.h"
+#include "host.h"
+#include "images.h"
+
+int main() {
+    // a.flac has a SEEKTABLE, b.flac has neither a SEEKTABLE nor a max frame size
+    const uint32_t samples[] = {4500 * 588, 3375 * 588};
+    const std::vector<int16_t> tracks[] = {images::pcm(samples[0]), images::pcm(samples[1])};
+    const images::Bytes files[] = {images::encodeFlac(tracks[0], 4096, 441000, true),
+                                   images::encodeFlac(tracks[1], 1152, 0, false)};
+    images::write("a.flac", files[0]);
+    images::write("b.flac", files[1]);
+    images::write("flac.cue", std::string("FILE \"a.flac\" WAVE\n  TRACK 01 AUDIO\n    INDEX 01 00:00:00\n"
+                                          "FILE \"b.flac\" WAVE\n  TRACK 02 AUDIO\n    INDEX 01 00:00:00\n"));
+    const int sectors = (samples[0] + samples[1]) / 588;
+
+    static picostation::DiscImage image;
+    CHECK(image.load("./flac.cue") == FR_OK);
+    CHECK(image.sectorCount() == sectors);
+
+    uint8_t buffer[2352];
+    auto expected = [&](int sector) -> const uint8_t * {
+        const int first = samples[0] / 588;
+        return sector < first ? reinterpret_cast<const uint8_t *>(&tracks[0][size_t(sector) * 1176])
+                              : reinterpret_cast<const uint8_t *>(&tracks[1][size_t(sector - first) * 1176]);
+    };
+
+    // Reading on must not restart the reader at every frame
+    int mismatches = 0;
+    uint32_t reads = host::readCount();
+    for (int sector = 0; sector < sectors; sector++) {
+        CHECK(image.readData(buffer, sector));
+        mismatches += memcmp(buffer, expected(sector), 2352) != 0;
+    }
+    reads = host::readCount() - reads;
+    const size_t fileBlocks = (files[0].size() + files[1].size()) / 512;
+    CHECK(reads < fileBlocks + fileBlocks / 10);
+    printf("flac sequential: %d mismatches, %u reads for %zu blocks\n", mismatches, reads, fileBlocks);
+
+    // A random seek walks at most a slot's worth of frames and decodes one, about 64 KB of FLAC here
+    uint32_t worst = 0;
+    for (int i = 0; i < 1000; i++) {
+        const int sector = (images::random8() << 8 | images::random8()) % sectors;
+        reads = host::readCount();
+        CHECK(image.readData(buffer, sector));
+        worst = MAX(worst, host::readCount() - reads);
+        mismatches += memcmp(buffer, expected(sector), 2352) != 0;
+    }
+    const uint32_t slotBlocks = files[0].size() / 512 * 65536 / samples[0];
+    CHECK(worst < 2 * slotBlocks + 16);
+    CHECK(mismatches == 0);
+    printf("flac random: %d mismatches, at most %u reads per seek, %u per slot\n", mismatches, worst, slotBlocks);
+
+    // Reload so nothing learned above helps, then seek with 100 us reads and a 2 ms deadline
+    CHECK(image.load("./flac.cue") == FR_OK);
+    host::setReadCost(100);
+    const int far = sectors - 100;
+    int attempts = 0;
+    bool ok = false;
+    while (!ok && attempts < 1000) {
+        attempts++;
+        image.setReadDeadline(time_us_64() + 2000);
+        ok = image.readData(buffer, far);
+    }
+    image.setReadDeadline(0);
+    host::setReadCost(0);
+    CHECK(ok && memcmp(buffer, expected(far), 2352) == 0);
+    CHECK(attempts > 1);
+    CHECK(!image.needsRemount());
+    printf("flac deadline: read after %d attempts\n", attempts);
+
+    // One flipped bit in the middle of b.flac, which decodes to other samples
+    images::Bytes damaged = files[1];
+    damaged[damaged.size() / 2] ^= 0x04;
+    images::write("b.flac", damaged);
+    CHECK(image.load("./flac.cue") == FR_OK);
+    int failed = 0;
+    mismatches = 0;
+    for (int sector = samples[0] / 588; sector < sectors; sector++) {
+        if (image.readData(buffer, sector)) {
+            mismatches += memcmp(buffer, expected(sector), 2352) != 0;
+        } else {
+            failed++;
+        }
+    }
+    CHECK(failed > 0 && failed <= 3);
+    CHECK(mismatches == 0);
+    printf("flac crc: %d sectors failed around the damaged frame\n", failed);
+    return g_checkFailures ? 1 : 0;
+}
@@ -0,0 +1,103 @@
+// PREGAP and POSTGAP sectors must be generated rather than read, on tracks that share a FILE with the previous
+// one and on tracks that start a new one, with the right headers and SubQ. The lead-out must start where the
+// last track really ends.
+#include <stdio.h>
+#include <string.h>
+
+#include <initializer_list>
+
+#include "disc_image.h"
+#include "host.h"
+#include "images.h"
+
+static int toBCD(const int value) { return (value / 10) << 4 | (value % 10); }
+
+// Disc sectors against the cue below: track 1 data 0-299, its POSTGAP 300-374, track 2's PREGAP 375-524 and its
+// audio 525-724 from the same file, track 3's PREGAP 725-799, its audio 800-899 and POSTGAP 900-949, lead-out 950
+static constexpr int c_leadOut = 950;
+
+int main() {
+    images::Bytes first = images::track(0, 300, 0);
+    const images::Bytes audio = images::track(0, 200, 3);
+    first.insert(first.end(), audio.begin(), audio.end());
+    const images::Bytes second = images::track(0, 100, 3);
+    images::write("gapa.bin", first);
+    images::write("gapb.bin", second);
+    images::write("gap.cue", std::string("FILE \"gapa.bin\" BINARY\n"
+                                         "  TRACK 01 MODE1/2352\n"
+                                         "    INDEX 01 00:00:00\n"
+                                         "    POSTGAP 00:01:00\n"
+                                         "  TRACK 02 AUDIO\n"
+                                         "    PREGAP 00:02:00\n"
+                                         "    INDEX 01 00:04:00\n"
+                                         "FILE \"gapb.bin\" BINARY\n"
+                                         "  TRACK 03 AUDIO\n"
+                                         "    PREGAP 00:01:00\n"
+                                         "    INDEX 01 00:00:00\n"
+                                         "    POSTGAP 00:00:50\n"));
+
+    static picostation::DiscImage image;
+    CHECK(image.load("./gap.cue") == FR_OK);
+    CHECK(image.sectorCount() == c_leadOut);
+
+    const int base = c_leadIn + c_preGap;
+    CHECK(image.isSynthetic(0));
+    CHECK(image.isSynthetic(base - 1));
+    auto synthetic = [&](const int first, const int end) {
+        int wrong = 0;
+        for (int lba = first; lba < end; lba++) {
+            wrong += !image.isSynthetic(lba + base);
+        }
+        return wrong == 0;
+    };
+    CHECK(synthetic(300, 375));
+    CHECK(synthetic(375, 525));
+    CHECK(synthetic(725, 800));
+    CHECK(synthetic(900, 950));
+    CHECK(synthetic(c_leadOut, c_leadOut + 10));
+
+    // Sectors from the files, first and last of each stretch
+    static uint8_t sector[2352];
+    auto fromFile = [&](const int lba, const images::Bytes &file, const int index, const int fileOrdinal) {
+        picostation::DiscImage::Location location;
+        return !image.isSynthetic(lba + base) && image.readData(sector, lba) &&
+               memcmp(sector, &file[size_t(index) * 2352], 2352) == 0 && image.locate(lba, &location) &&
+               location.file == fileOrdinal && location.index == index;
+    };
+    CHECK(fromFile(0, first, 0, 0));
+    CHECK(fromFile(299, first, 299, 0));
+    CHECK(fromFile(525, first, 300, 0));
+    CHECK(fromFile(724, first, 499, 0));
+    CHECK(fromFile(800, second, 0, 1));
+    CHECK(fromFile(899, second, 99, 1));
+
+    // A data track's POSTGAP gets mode 1 sectors addressed like the rest of the disc, audio gaps get silence
+    bool isData = false;
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(image.syntheticSector(340 + base, &isData));
+    CHECK(data && isData);
+    if (data) {
+        CHECK(data[12] == toBCD(0) && data[13] == toBCD(6) && data[14] == toBCD(40) && data[15] == 1);
+        CHECK(picostation::edcecc::checkEDC(data));
+    }
+    static const uint8_t zeros[2352] = {};
+    for (const int lba : {400, 760, 920, c_leadOut}) {
+        data = reinterpret_cast<const uint8_t *>(image.syntheticSector(lba + base, &isData));
+        CHECK(data && !isData && memcmp(data, zeros, sizeof(zeros)) == 0);
+    }
+
+    // Track 2's PREGAP counts down to its INDEX 01
+    picostation::SubQ::Data subq = image.generateSubQ(400 + base);
+    CHECK(subq.tno == 0x02 && subq.x == 0x00 && subq.min == 0x00 && subq.sec == 0x01 && subq.frame == 0x50);
+    CHECK(subq.amin == 0x00 && subq.asec == 0x07 && subq.aframe == 0x25);
+    subq = image.generateSubQ(525 + base);
+    CHECK(subq.tno == 0x02 && subq.x == 0x01 && subq.min == 0x00 && subq.sec == 0x00 && subq.frame == 0x00);
+    subq = image.generateSubQ(310 + base);  // Track 1's POSTGAP still belongs to it
+    CHECK(subq.tno == 0x01 && subq.ctrladdr == 0x41 && subq.sec == 0x04 && subq.frame == 0x10);
+    subq = image.generateSubQ(c_leadOut + base);
+    CHECK(subq.tno == 0xAA);
+    subq = image.generateSubQ(16);  // The A2 TOC entry in the lead-in
+    CHECK(subq.point == 0xA2 && subq.pmin == 0x00 && subq.psec == 0x14 && subq.pframe == 0x50);
+
+    printf("gap: %d sectors up to the lead-out\n", image.sectorCount());
+    return g_checkFailures ? 1 : 0;
+}
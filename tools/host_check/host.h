@@ -0,0 +1,23 @@
+// Controls for the host stand-ins in stub/
+#pragma once
+
+#include <stdint.h>
+
+namespace host {
+void setTime(uint64_t us);
+void advanceTime(uint64_t us);
+// Every f_read takes readCostUs of the clock. The next failReads reads return FR_DISK_ERR without reading.
+void setReadCost(uint64_t us);
+void failReads(int count);
+uint32_t readCount();
+}  // namespace host
+
+// Checks print the failing expression and count towards the exit code
+extern int g_checkFailures;
+#define CHECK(expr)                                                              \
+    do {                                                                         \
+        if (!(expr)) {                                                           \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr);      \
+            g_checkFailures++;                                                   \
+        }                                                                        \
+    } while (0)
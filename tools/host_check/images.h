@@ -0,0 +1,365 @@
+// Generated test images: raw sectors, ECM and FLAC encoding and cue sheets, written to the working directory
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "edc_ecc.h"
+#include "pico/stdlib.h"  // MIN and MAX
+
+namespace images {
+typedef std::vector<uint8_t> Bytes;
+
+inline uint32_t s_seed = 1;
+inline uint8_t random8() {
+    s_seed = s_seed * 1103515245 + 12345;
+    return s_seed >> 16;
+}
+
+inline void fill(uint8_t *data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        data[i] = random8();
+    }
+}
+
+// A valid raw sector at lba. form 0 is mode 1, 1 and 2 are the mode 2 forms, 3 is audio.
+inline void sector(uint8_t *out, const int lba, const int form) {
+    if (form == 3) {
+        fill(out, 2352);
+        return;
+    }
+    memset(out, 0, 2352);
+    if (form == 0) {
+        fill(out + 16, 2048);
+        picostation::edcecc::buildMode1(out, lba);
+        return;
+    }
+    picostation::edcecc::buildMode2(out, lba);
+    const uint8_t submode = form == 2 ? 0x20 : 0x08;
+    const uint8_t subheader[4] = {0, 0, submode, 0};
+    memcpy(out + 16, subheader, 4);
+    memcpy(out + 20, subheader, 4);
+    if (form == 1) {
+        fill(out + 24, 2048);
+        picostation::edcecc::encodeMode2Form1(out);
+    } else {
+        fill(out + 24, 2324);
+        picostation::edcecc::encodeMode2Form2(out);
+    }
+}
+
+inline Bytes track(const int firstLba, const int count, const int form) {
+    Bytes bytes(size_t(count) * 2352);
+    for (int i = 0; i < count; i++) {
+        // Mode 2 tracks mix both forms like XA interleave
+        const int sectorForm = (form == 1 && (i % 8) == 7) ? 2 : form;
+        sector(&bytes[size_t(i) * 2352], firstLba + i, sectorForm);
+    }
+    return bytes;
+}
+
+inline void write(const std::string &path, const Bytes &bytes) {
+    FILE *file = fopen(path.c_str(), "wb");
+    fwrite(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+}
+
+inline void write(const std::string &path, const std::string &text) {
+    write(path, Bytes(text.begin(), text.end()));
+}
+
+// Encodes a raw image the way the ecm tool does. Mode 1 sectors whose EDC/ECC can be rebuilt become mode 1 records.
+// Mode 2 records hold the 2336 bytes after the header, like unecm writes them, so each mode 2 sector is a 16-byte
+// raw record followed by a one-sector form 1 or form 2 record. Everything else is stored as raw bytes.
+inline Bytes encodeEcm(const Bytes &raw) {
+    auto typeOf = [&](size_t offset) {
+        if (offset % 2352 || offset + 2352 > raw.size()) {
+            return 0;
+        }
+        const uint8_t *in = &raw[offset];
+        uint8_t check[2352];
+        memcpy(check, in, 2352);
+        if (in[15] == 1) {
+            picostation::edcecc::encodeMode1(check);
+            return memcmp(check, in, 2352) == 0 ? 1 : 0;
+        }
+        if (in[15] == 2 && memcmp(in + 16, in + 20, 4) == 0) {
+            if (in[18] & 0x20) {
+                picostation::edcecc::encodeMode2Form2(check);
+                return memcmp(check, in, 2352) == 0 ? 3 : 0;
+            }
+            picostation::edcecc::encodeMode2Form1(check);
+            return memcmp(check, in, 2352) == 0 ? 2 : 0;
+        }
+        return 0;
+    };
+    auto header = [](Bytes &out, int type, uint32_t count) {
+        uint32_t n = count - 1;
+        uint8_t c = (type & 3) | ((n & 0x1F) << 2);
+        n >>= 5;
+        while (n) {
+            out.push_back(c | 0x80);
+            c = n & 0x7F;
+            n >>= 7;
+        }
+        out.push_back(c);
+    };
+
+    Bytes out = {'E', 'C', 'M', 0};
+    size_t offset = 0;
+    while (offset < raw.size()) {
+        const int type = typeOf(offset);
+        if (type == 0) {
+            size_t end = offset;
+            while (end < raw.size() && typeOf(end) == 0) {
+                end += MIN(size_t(2352), raw.size() - end);
+            }
+            header(out, 0, end - offset);
+            out.insert(out.end(), &raw[offset], &raw[offset] + (end - offset));
+            offset = end;
+        } else if (type == 1) {
+            uint32_t count = 0;
+            size_t end = offset;
+            while (end < raw.size() && typeOf(end) == 1 && count < 64) {  // Short runs, more records
+                end += 2352;
+                count++;
+            }
+            header(out, 1, count);
+            for (size_t at = offset; at < end; at += 2352) {
+                out.insert(out.end(), &raw[at + 12], &raw[at + 15]);
+                out.insert(out.end(), &raw[at + 16], &raw[at + 16 + 2048]);
+            }
+            offset = end;
+        } else {
+            header(out, 0, 16);
+            out.insert(out.end(), &raw[offset], &raw[offset + 16]);
+            header(out, type, 1);
+            out.insert(out.end(), &raw[offset + 20], &raw[offset + 24 + (type == 2 ? 2048 : 2324)]);
+            offset += 2352;
+        }
+    }
+    // End of stream marker, then the image EDC the decoder does not check
+    const uint8_t end[] = {0xFC, 0xFF, 0xFF, 0xFF, 0x3F, 0, 0, 0, 0};
+    out.insert(out.end(), end, end + sizeof(end));
+    return out;
+}
+// CD audio as interleaved 16-bit stereo samples: tones with some noise, and a stretch of silence
+inline std::vector<int16_t> pcm(const uint32_t samples) {
+    std::vector<int16_t> out(size_t(samples) * 2);
+    for (uint32_t i = 0; i < samples; i++) {
+        const bool silent = (i / 44100) % 10 == 3;
+        const int noise = (random8() & 0x3F) - 32;
+        out[i * 2] = silent ? 0 : int16_t(12000 * sin(i * 0.031) + 3000 * sin(i * 0.0007) + noise);
+        out[i * 2 + 1] = silent ? 0 : int16_t(9000 * sin(i * 0.047 + 1) + noise);
+    }
+    return out;
+}
+
+class BitWriter {
+  public:
+    void put(uint32_t value, uint bits) {
+        for (uint i = bits; i > 0; i--) {
+            m_cache = m_cache << 1 | ((value >> (i - 1)) & 1);
+            if (++m_count == 8) {
+                m_bytes.push_back(m_cache);
+                m_cache = 0;
+                m_count = 0;
+            }
+        }
+    }
+    void align() {
+        if (m_count) {
+            put(0, 8 - m_count);
+        }
+    }
+    Bytes &bytes() { return m_bytes; }
+
+  private:
+    Bytes m_bytes;
+    uint8_t m_cache = 0;
+    uint m_count = 0;
+};
+
+inline uint8_t flacCrc8(const uint8_t *data, size_t length) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+inline uint16_t flacCrc16(const uint8_t *data, size_t length) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// Subframe of one channel: constant when it can be, otherwise verbatim or a fixed predictor picked by frame number
+inline void flacSubframe(BitWriter &out, const std::vector<int32_t> &in, const uint bps, const uint32_t frame) {
+    const size_t n = in.size();
+    bool constant = true;
+    for (size_t i = 1; i < n; i++) {
+        constant &= in[i] == in[0];
+    }
+    if (constant) {
+        out.put(0, 8);
+        out.put(uint32_t(in[0]), bps);
+        return;
+    }
+    if (frame % 7 == 3) {
+        out.put(1 << 1, 8);
+        for (int32_t value : in) {
+            out.put(uint32_t(value), bps);
+        }
+        return;
+    }
+
+    const uint order = MIN(frame % 5, uint(n));
+    out.put((8 + order) << 1, 8);
+    for (uint i = 0; i < order; i++) {
+        out.put(uint32_t(in[i]), bps);
+    }
+    std::vector<uint32_t> residual;
+    uint64_t sum = 0;
+    for (size_t i = order; i < n; i++) {
+        static const int c_coefficients[5][4] = {{}, {1}, {2, -1}, {3, -3, 1}, {4, -6, 4, -1}};
+        int32_t prediction = 0;
+        for (uint j = 0; j < order; j++) {
+            prediction += c_coefficients[order][j] * in[i - 1 - j];
+        }
+        const int32_t value = in[i] - prediction;
+        residual.push_back(uint32_t(value) << 1 ^ uint32_t(value >> 31));
+        sum += residual.back();
+    }
+    uint parameter = 0;
+    while (parameter < 14 && (uint64_t(residual.size()) << (parameter + 1)) < sum) {
+        parameter++;
+    }
+    out.put(0, 2);  // Rice, 4-bit parameters
+    out.put(0, 4);  // One partition
+    out.put(parameter, 4);
+    for (uint32_t value : residual) {
+        for (uint32_t q = value >> parameter; q > 0; q--) {
+            out.put(0, 1);
+        }
+        out.put(1, 1);
+        out.put(value, parameter);
+    }
+}
+
+// A fixed block size FLAC stream. Frames cycle through the four stereo channel assignments. seekPoints adds a
+// SEEKTABLE with a point that often and one bad point, 0 for none; a zero max frame size in STREAMINFO means
+// unknown.
+inline Bytes encodeFlac(const std::vector<int16_t> &samples, const uint32_t blockSize, const uint32_t seekPoints,
+                        const bool frameSizeKnown) {
+    const uint32_t total = samples.size() / 2;
+    Bytes frames;
+    std::vector<uint32_t> offsets;
+    uint32_t maxFrame = 0;
+    for (uint32_t frame = 0; frame * blockSize < total; frame++) {
+        const uint32_t first = frame * blockSize;
+        const uint32_t n = MIN(blockSize, total - first);
+        offsets.push_back(frames.size());
+
+        BitWriter out;
+        const uint8_t assignment = (const uint8_t[]){1, 8, 9, 10}[frame % 4];
+        out.put(0xFFF8, 16);
+        out.put(7 << 4 | 9, 8);  // 16-bit block size at the end of the header, 44.1 kHz
+        out.put(assignment << 4 | 4 << 1, 8);
+        if (frame < 0x80) {
+            out.put(frame, 8);
+        } else if (frame < 0x800) {
+            out.put(0xC0 | frame >> 6, 8);
+            out.put(0x80 | (frame & 0x3F), 8);
+        } else {
+            out.put(0xE0 | frame >> 12, 8);
+            out.put(0x80 | ((frame >> 6) & 0x3F), 8);
+            out.put(0x80 | (frame & 0x3F), 8);
+        }
+        out.put(n - 1, 16);
+        out.put(flacCrc8(out.bytes().data(), out.bytes().size()), 8);
+
+        std::vector<int32_t> a(n);
+        std::vector<int32_t> b(n);
+        for (uint32_t i = 0; i < n; i++) {
+            const int32_t left = samples[(first + i) * 2];
+            const int32_t right = samples[(first + i) * 2 + 1];
+            switch (assignment) {
+                case 1:
+                    a[i] = left;
+                    b[i] = right;
+                    break;
+                case 8:
+                    a[i] = left;
+                    b[i] = left - right;
+                    break;
+                case 9:
+                    a[i] = left - right;
+                    b[i] = right;
+                    break;
+                default:
+                    a[i] = (left + right) >> 1;
+                    b[i] = left - right;
+                    break;
+            }
+        }
+        flacSubframe(out, a, assignment == 9 ? 17 : 16, frame);
+        flacSubframe(out, b, assignment == 8 || assignment == 10 ? 17 : 16, frame);
+        out.align();
+        out.put(flacCrc16(out.bytes().data(), out.bytes().size()), 16);
+        maxFrame = MAX(maxFrame, uint32_t(out.bytes().size()));
+        frames.insert(frames.end(), out.bytes().begin(), out.bytes().end());
+    }
+
+    std::vector<std::pair<uint64_t, uint64_t>> points;
+    for (uint32_t sample = 0; seekPoints && sample < total; sample += seekPoints) {
+        points.push_back({sample / blockSize * blockSize, offsets[sample / blockSize]});
+    }
+    if (points.size() > 2 && (points[1].first + 3 * seekPoints / 2) / blockSize < offsets.size()) {
+        // Not a frame start, the decoder must notice and fall back to an earlier point
+        const uint32_t frame = (points[1].first + 3 * seekPoints / 2) / blockSize;
+        points.push_back({uint64_t(frame) * blockSize, offsets[frame] + 5});
+    }
+
+    Bytes file = {'f', 'L', 'a', 'C'};
+    auto put = [&](uint64_t value, uint bytes) {
+        for (uint i = bytes; i > 0; i--) {
+            file.push_back(value >> ((i - 1) * 8));
+        }
+    };
+    put(points.empty() ? 0x80 : 0x00, 1);
+    put(34, 3);
+    put(blockSize, 2);
+    put(blockSize, 2);
+    put(0, 3);
+    put(frameSizeKnown ? maxFrame : 0, 3);
+    put(uint64_t(44100) << 44 | uint64_t(1) << 41 | uint64_t(15) << 36 | total, 8);
+    put(0, 8);  // MD5
+    put(0, 8);
+    if (!points.empty()) {
+        points.push_back({0xFFFFFFFFFFFFFFFF, 0});  // Placeholder
+        put(0x83, 1);
+        put(points.size() * 18, 3);
+        for (const auto &point : points) {
+            put(point.first, 8);
+            put(point.second, 8);
+            put(point.first == 0xFFFFFFFFFFFFFFFF ? 0 : blockSize, 2);
+        }
+    }
+    file.insert(file.end(), frames.begin(), frames.end());
+    return file;
+}
+}  // namespace images
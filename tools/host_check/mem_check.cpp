@@ -0,0 +1,33 @@
+// The memory report must build and run off the device. Stack figures are device only and read 0 here, the heap's
+// must follow an allocation where the C library keeps count (ASan's allocator reports nothing).
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "mem_stats.h"
+
+static void *volatile s_block;  // Keeps the allocation from being optimised away
+
+int main() {
+    static constexpr size_t c_blockSize = 64 * 1024;  // Below glibc's mmap threshold, so it comes from the arena
+    picostation::memstats::paintStack();
+    const picostation::memstats::StackStats stack = picostation::memstats::getStackStats(0);
+    CHECK(stack.size == 0 && stack.peak == 0);
+
+    const picostation::memstats::HeapStats before = picostation::memstats::getHeapStats();
+    s_block = malloc(c_blockSize);
+    memset(s_block, 0, c_blockSize);
+    const picostation::memstats::HeapStats during = picostation::memstats::getHeapStats();
+    free(s_block);
+    const picostation::memstats::HeapStats after = picostation::memstats::getHeapStats();
+    if (during.arena == 0) {
+        printf("mem: no heap figures from this allocator\n");
+    } else {
+        CHECK(during.used >= before.used + c_blockSize);
+        CHECK(during.used + during.freeInArena <= during.arena);
+        CHECK(after.used + c_blockSize <= during.used);
+    }
+    picostation::memstats::report();
+    return g_checkFailures ? 1 : 0;
+}
@@ -0,0 +1,108 @@
+// Directory sectors that keep missing between other reads must be learned and added to the ISO 9660 defaults in
+// the .pin file, a pause loop over sectors the cache holds must not be, and after a reload the pinned sectors cost
+// no SD reads.
+#include <stdio.h>
+#include <string.h>
+
+#include "disc_image.h"
+#include "host.h"
+#include "images.h"
+#include "pinned_sectors.h"
+#include "sector_cache.h"
+
+static void putLE32(uint8_t *out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = value >> (i * 8);
+    }
+}
+
+int main() {
+    // Volume descriptor at 16, path table at 18, a two sector root directory at 22
+    images::Bytes track = images::track(0, 3000, 0);
+    uint8_t *pvd = &track[16 * 2352 + 16];
+    pvd[0] = 1;
+    memcpy(pvd + 1, "CD001", 5);
+    putLE32(pvd + 140, 18);
+    putLE32(pvd + 156 + 2, 22);
+    putLE32(pvd + 156 + 10, 2 * 2048);
+    picostation::edcecc::buildMode1(&track[16 * 2352], 16);
+    images::write("pin.bin", track);
+    images::write("pin.cue", std::string("FILE \"pin.bin\" BINARY\n  TRACK 01 MODE1/2352\n    INDEX 01 00:00:00\n"));
+    remove("pin.pin");
+
+    const int base = c_leadIn + c_preGap;
+    static picostation::DiscImage image;
+    static picostation::SectorCache cache(&image);
+    static picostation::PinnedSectors pinned;
+    auto load = [&]() {
+        CHECK(image.load("./pin.cue") == FR_OK);
+        cache.reset();
+        pinned.load("./pin.cue", &image);
+        for (int i = 0; i < pinned.count(); i++) {
+            cache.pin(pinned.lba(i) + base);
+        }
+        image.generateSubQ(base + 16);  // The current track is data
+    };
+    // As core1 plays a sector
+    auto play = [&](const int lba) {
+        const uint32_t remisses = cache.getStats().remisses;
+        cache.get(lba + base);
+        if (cache.getStats().remisses != remisses && !cache.isStreaming()) {
+            pinned.record(lba);
+        }
+    };
+
+    load();
+    CHECK(pinned.count() == 4);
+    // Pause: the head keeps jumping back over the same few sectors
+    for (int loop = 0; loop < 200; loop++) {
+        for (int lba = 2950; lba < 2958; lba++) {
+            play(lba);
+        }
+    }
+    host::advanceTime(picostation::PinnedSectors::c_saveIntervalUs);
+    pinned.maybeSave();
+    FILE *file = fopen("pin.pin", "r");
+    CHECK(!file);  // Nothing learned, nothing written
+    if (file) {
+        fclose(file);
+    }
+    for (int i = 0; i < 10; i++) {
+        for (int lba = 100; lba < 104; lba++) {
+            play(lba);
+        }
+        // Scattered file reads push the directory out of the main slots, then a stream that can't
+        for (int j = 0; j < 40; j++) {
+            play(300 + i * 80 + j * 2);
+        }
+        for (int lba = 1100 + i * 180; lba < 1280 + i * 180; lba++) {
+            play(lba);
+        }
+    }
+    host::advanceTime(picostation::PinnedSectors::c_saveIntervalUs);
+    pinned.maybeSave();
+
+    std::string saved;
+    file = fopen("pin.pin", "r");
+    CHECK(file);
+    char line[16];
+    while (file && fgets(line, sizeof(line), file)) {
+        saved += line;
+    }
+    if (file) {
+        fclose(file);
+    }
+    CHECK(saved == "16\n18\n22\n23\n100\n101\n102\n103\n");
+
+    load();
+    CHECK(pinned.count() == 8);
+    const uint32_t reads = host::readCount();
+    for (int lba : {16, 18, 22, 23, 100, 101, 102, 103}) {
+        const uint16_t *data = cache.get(lba + base);
+        CHECK(memcmp(data, &track[size_t(lba) * 2352], 2352) == 0);
+    }
+    CHECK(host::readCount() == reads);
+    printf("pinned: %zu bytes saved, %u reads for the pinned sectors after a reload\n", saved.size(),
+           (unsigned)(host::readCount() - reads));
+    return g_checkFailures ? 1 : 0;
+}
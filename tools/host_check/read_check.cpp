@@ -0,0 +1,78 @@
+// A read that fails once must be retried and return the sector. One that keeps failing must go out zero-filled,
+// stay out of the sector cache and, three in a row, ask for a remount. Retries must stop at the read deadline.
+#include <stdio.h>
+#include <string.h>
+
+#include "disc_image.h"
+#include "host.h"
+#include "images.h"
+#include "sector_cache.h"
+
+int main() {
+    images::Bytes track = images::track(0, 400, 0);
+    images::write("read.bin", track);
+    images::write("read.cue", std::string("FILE \"read.bin\" BINARY\n  TRACK 01 MODE1/2352\n    INDEX 01 00:00:00\n"));
+
+    static picostation::DiscImage image;
+    CHECK(image.load("./read.cue") == FR_OK);
+    image.resetReadStats();
+    static uint8_t sector[2352];
+    static const uint8_t zeros[2352] = {};
+    auto matches = [&](const uint8_t *data, const int lba) {
+        return memcmp(data, &track[size_t(lba) * 2352], 2352) == 0;
+    };
+
+    // A glitch is retried
+    host::failReads(1);
+    CHECK(image.readData(sector, 100));
+    CHECK(matches(sector, 100));
+    picostation::DiscImage::ReadStats stats = image.getReadStats();
+    CHECK(stats.reads == 1 && stats.retries == 1 && stats.failures == 0);
+
+    // A card that stopped answering
+    for (int i = 0; i < int(picostation::DiscImage::c_remountFailures); i++) {
+        CHECK(!image.needsRemount());
+        memset(sector, 0xA5, sizeof(sector));
+        host::failReads(picostation::DiscImage::c_maxReadAttempts);
+        CHECK(!image.readData(sector, 110 + i));
+        CHECK(memcmp(sector, zeros, sizeof(sector)) == 0);
+    }
+    CHECK(image.needsRemount());
+    stats = image.getReadStats();
+    CHECK(stats.reads == 4 && stats.failures == 3);
+    CHECK(stats.retries == 1 + 3 * (picostation::DiscImage::c_maxReadAttempts - 1));
+    CHECK(image.readData(sector, 120));
+    CHECK(!image.needsRemount());  // One good read and the card is back
+
+    // No retry that would end past the deadline
+    image.resetReadStats();
+    host::setReadCost(5000);
+    host::failReads(picostation::DiscImage::c_maxReadAttempts);
+    image.setReadDeadline(time_us_64() + 8000);
+    CHECK(!image.readData(sector, 130));
+    stats = image.getReadStats();
+    CHECK(stats.retries == 0 && stats.failures == 1);
+    host::failReads(0);
+    host::setReadCost(0);
+    image.setReadDeadline(0);
+
+    // A failed read is not kept: the next request reads the sector again and gets it
+    static picostation::SectorCache cache(&image);
+    const int base = c_leadIn + c_preGap;
+    host::failReads(picostation::DiscImage::c_maxReadAttempts);
+    const uint16_t *data = cache.get(200 + base);
+    CHECK(memcmp(data, zeros, sizeof(zeros)) == 0);
+    const uint32_t reads = host::readCount();
+    data = cache.get(200 + base);
+    CHECK(host::readCount() == reads + 1);
+    CHECK(matches((const uint8_t *)data, 200));
+    data = cache.get(200 + base);
+    CHECK(host::readCount() == reads + 1);
+    host::failReads(picostation::DiscImage::c_maxReadAttempts);
+    CHECK(!cache.pin(210 + base));  // Nor pinned
+
+    stats = image.getReadStats();
+    printf("read: %u reads, %u retries, %u failures\n", (unsigned)stats.reads, (unsigned)stats.retries,
+           (unsigned)stats.failures);
+    return g_checkFailures ? 1 : 0;
+}
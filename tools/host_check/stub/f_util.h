@@ -0,0 +1,11 @@
+#pragma once
+
+#include "ff.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+const char *FRESULT_str(FRESULT i);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,128 @@
+#include <stdarg.h>
+#include <string.h>
+
+#include "../host.h"
+#include "f_util.h"
+#include "ff.h"
+#include "ff_stdio.h"
+#include "pico/stdlib.h"
+
+int g_checkFailures = 0;
+
+static uint64_t s_now = 0;
+static uint64_t s_readCostUs = 0;
+static int s_failReads = 0;
+static uint32_t s_readCount = 0;
+
+void host::setTime(uint64_t us) { s_now = us; }
+void host::advanceTime(uint64_t us) { s_now += us; }
+void host::setReadCost(uint64_t us) { s_readCostUs = us; }
+void host::failReads(int count) { s_failReads = count; }
+uint32_t host::readCount() { return s_readCount; }
+
+uint64_t time_us_64(void) { return s_now; }
+
+FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode) {
+    const char *fmode = "rb";
+    if (mode & FA_WRITE) {
+        fmode = (mode & FA_CREATE_ALWAYS) ? "wb+" : ((mode & FA_OPEN_APPEND) == FA_OPEN_APPEND ? "ab+" : "rb+");
+    }
+    fp->fp = fopen(path, fmode);
+    fp->err = 0;
+    return fp->fp ? FR_OK : FR_NO_FILE;
+}
+
+FRESULT f_close(FIL *fp) {
+    if (fp->fp) {
+        fclose(fp->fp);
+        fp->fp = nullptr;
+    }
+    return FR_OK;
+}
+
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br) {
+    s_now += s_readCostUs;
+    s_readCount++;
+    if (s_failReads > 0) {
+        s_failReads--;
+        *br = 0;
+        return FR_DISK_ERR;
+    }
+    *br = fread(buff, 1, btr, fp->fp);
+    return FR_OK;
+}
+
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw) {
+    *bw = fwrite(buff, 1, btw, fp->fp);
+    return *bw == btw ? FR_OK : FR_DISK_ERR;
+}
+
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs) { return fseek(fp->fp, ofs, SEEK_SET) == 0 ? FR_OK : FR_INT_ERR; }
+FRESULT f_sync(FIL *fp) { return fflush(fp->fp) == 0 ? FR_OK : FR_DISK_ERR; }
+FRESULT f_unlink(const TCHAR *path) { return remove(path) == 0 ? FR_OK : FR_NO_FILE; }
+
+FRESULT f_stat(const TCHAR *path, FILINFO *fno) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return FR_NO_FILE;
+    }
+    if (fno) {
+        fseek(file, 0, SEEK_END);
+        fno->fsize = ftell(file);
+    }
+    fclose(file);
+    return FR_OK;
+}
+
+TCHAR *f_gets(TCHAR *buff, int len, FIL *fp) { return fgets(buff, len, fp->fp); }
+int f_puts(const TCHAR *str, FIL *fp) { return fputs(str, fp->fp) < 0 ? -1 : (int)strlen(str); }
+
+int f_printf(FIL *fp, const TCHAR *str, ...) {
+    va_list args;
+    va_start(args, str);
+    const int result = vfprintf(fp->fp, str, args);
+    va_end(args);
+    return result;
+}
+
+FSIZE_t f_tell(FIL *fp) { return ftell(fp->fp); }
+
+FSIZE_t f_size(FIL *fp) {
+    const long position = ftell(fp->fp);
+    fseek(fp->fp, 0, SEEK_END);
+    const long size = ftell(fp->fp);
+    fseek(fp->fp, position, SEEK_SET);
+    return size;
+}
+
+const char *FRESULT_str(FRESULT i) { return i == FR_OK ? "FR_OK" : "FR_ERROR"; }
+
+FIL *ff_fopen(const char *pcFile, const char *pcMode) {
+    FIL *fil = (FIL *)malloc(sizeof(FIL));
+    if (f_open(fil, pcFile, strchr(pcMode, 'w') ? FA_WRITE | FA_CREATE_ALWAYS : FA_READ) != FR_OK) {
+        free(fil);
+        return nullptr;
+    }
+    return fil;
+}
+
+int ff_fclose(FIL *pxStream) {
+    f_close(pxStream);
+    free(pxStream);
+    return 0;
+}
+
+size_t ff_fread(void *pvBuffer, size_t xSize, size_t xItems, FIL *pxStream) {
+    return fread(pvBuffer, xSize, xItems, pxStream->fp);
+}
+
+size_t ff_fwrite(const void *pvBuffer, size_t xSize, size_t xItems, FIL *pxStream) {
+    return fwrite(pvBuffer, xSize, xItems, pxStream->fp);
+}
+
+int ff_fseek(FIL *pxStream, long lOffset, int iWhence) {
+    const int whence = iWhence == FF_SEEK_END ? SEEK_END : (iWhence == FF_SEEK_CUR ? SEEK_CUR : SEEK_SET);
+    return fseek(pxStream->fp, lOffset, whence);
+}
+
+long ff_ftell(FIL *pxStream) { return ftell(pxStream->fp); }
@@ -0,0 +1,71 @@
+// Host stand-in for FatFs over stdio, just the calls the firmware makes. See fatfs.cpp.
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+typedef char TCHAR;
+typedef unsigned int UINT;
+typedef uint8_t BYTE;
+typedef uint64_t FSIZE_t;
+
+typedef enum {
+    FR_OK = 0,
+    FR_DISK_ERR,
+    FR_INT_ERR,
+    FR_NOT_READY,
+    FR_NO_FILE,
+    FR_NO_PATH,
+    FR_INVALID_NAME,
+    FR_DENIED,
+    FR_EXIST,
+    FR_INVALID_OBJECT,
+    FR_WRITE_PROTECTED,
+    FR_INVALID_DRIVE,
+    FR_NOT_ENABLED,
+    FR_NO_FILESYSTEM,
+    FR_MKFS_ABORTED,
+    FR_TIMEOUT,
+    FR_LOCKED,
+    FR_NOT_ENOUGH_CORE,
+    FR_TOO_MANY_OPEN_FILES,
+    FR_INVALID_PARAMETER
+} FRESULT;
+
+#define FA_READ 0x01
+#define FA_WRITE 0x02
+#define FA_OPEN_EXISTING 0x00
+#define FA_CREATE_NEW 0x04
+#define FA_CREATE_ALWAYS 0x08
+#define FA_OPEN_ALWAYS 0x10
+#define FA_OPEN_APPEND 0x30
+
+typedef struct {
+    FILE *fp;
+    int err;
+} FIL;
+
+typedef struct {
+    FSIZE_t fsize;
+} FILINFO;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode);
+FRESULT f_close(FIL *fp);
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br);
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw);
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs);
+FRESULT f_sync(FIL *fp);
+FRESULT f_unlink(const TCHAR *path);
+FRESULT f_stat(const TCHAR *path, FILINFO *fno);
+TCHAR *f_gets(TCHAR *buff, int len, FIL *fp);
+int f_puts(const TCHAR *str, FIL *cp);
+int f_printf(FIL *fp, const TCHAR *str, ...);
+FSIZE_t f_tell(FIL *fp);
+FSIZE_t f_size(FIL *fp);
+#ifdef __cplusplus
+}
+#endif
+#define f_error(fp) ((fp)->err)
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "ff.h"
+
+#define FF_SEEK_SET 0
+#define FF_SEEK_CUR 1
+#define FF_SEEK_END 2
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+FIL *ff_fopen(const char *pcFile, const char *pcMode);
+int ff_fclose(FIL *pxStream);
+size_t ff_fread(void *pvBuffer, size_t xSize, size_t xItems, FIL *pxStream);
+size_t ff_fwrite(const void *pvBuffer, size_t xSize, size_t xItems, FIL *pxStream);
+int ff_fseek(FIL *pxStream, long lOffset, int iWhence);
+long ff_ftell(FIL *pxStream);
+#ifdef __cplusplus
+}
+#endif
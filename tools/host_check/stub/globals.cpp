@@ -0,0 +1,7 @@
+// The picostation globals the image modules read, normally defined in picostation.cpp
+#include "picostation.h"
+
+uint picostation::g_audioCtrlMode = picostation::audioControlModes::NORMAL;
+volatile int32_t picostation::g_audioPeak = 0;
+volatile int32_t picostation::g_audioLevel = 0;
+volatile uint32_t picostation::g_audioPeakResets = 0;
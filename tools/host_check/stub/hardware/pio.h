@@ -0,0 +1,8 @@
+#pragma once
+
+#include "pico/stdlib.h"
+
+typedef struct pio_hw pio_hw_t;
+typedef pio_hw_t *PIO;
+#define pio0 ((PIO)0x50200000)
+#define pio1 ((PIO)0x50300000)
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "pico/stdlib.h"
+
+typedef struct {
+    uint32_t csr;
+    uint32_t div;
+    uint32_t top;
+} pwm_config;
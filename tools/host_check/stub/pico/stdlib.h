@@ -0,0 +1,28 @@
+// Host stand-in for the SDK bits the image modules use. time_us_64() is a settable clock, see host.h.
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef unsigned int uint;
+
+#ifndef MIN
+#define MIN(a, b) ((b) < (a) ? (b) : (a))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+#endif
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+#define __time_critical_func(func) func
+#define __not_in_flash_func(func) func
+#define __scratch_y(name)
+#define panic(...) (fprintf(stderr, __VA_ARGS__), abort())
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+uint64_t time_us_64(void);
+#ifdef __cplusplus
+}
+#endif
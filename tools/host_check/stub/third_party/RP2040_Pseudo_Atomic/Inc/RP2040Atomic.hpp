@@ -0,0 +1,24 @@
+// Single threaded host stand-in
+#pragma once
+
+namespace patom {
+namespace types {
+template <typename T>
+class patomic {
+  public:
+    patomic(T value = T()) : m_value(value) {}
+    T Load() const { return m_value; }
+    void Store(T value) { m_value = value; }
+    patomic &operator=(T value) {
+        m_value = value;
+        return *this;
+    }
+    operator T() const { return m_value; }
+
+  private:
+    T m_value;
+};
+typedef patomic<int> patomic_int;
+typedef patomic<bool> patomic_bool;
+}  // namespace types
+}  // namespace patom
@@ -0,0 +1,112 @@
+// A clean MODE1 image must verify without a bad sector, and a single flipped byte must be reported and listed in
+// the .bad file both against the .crc checksums and, without them, against the sector's EDC.
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include "disc_image.h"
+#include "host.h"
+#include "image_verify.h"
+#include "images.h"
+
+// zlib's CRC-32, as tools/make_crc.py stores it
+static uint32_t crc32(const uint8_t *data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+        }
+    }
+    return ~crc;
+}
+
+// The sidecar make_crc.py writes for a single FILE of raw sectors
+static void writeSidecar(const images::Bytes &track) {
+    const uint32_t count = track.size() / 2352;
+    images::Bytes out;
+    auto put = [&](const uint32_t value, const int bytes) {
+        for (int i = 0; i < bytes; i++) {
+            out.push_back(value >> (i * 8));
+        }
+    };
+    out.insert(out.end(), {'P', 'S', 'C', 'K'});
+    put(1, 2);       // Version
+    put(1, 2);       // File count
+    put(8 + 12, 4);  // Checksum offset
+    put(count, 4);
+    put(2352, 2);
+    put(0, 2);
+    for (uint32_t i = 0; i < count; i++) {
+        put(crc32(&track[size_t(i) * 2352], 2352), 4);
+    }
+    images::write("verify.crc", out);
+}
+
+static std::string readBadList() {
+    std::string list;
+    FILE *file = fopen("verify.bad", "r");
+    if (!file) {
+        return list;
+    }
+    char line[64];
+    while (fgets(line, sizeof(line), file)) {
+        list += line;
+    }
+    fclose(file);
+    return list;
+}
+
+static picostation::ImageVerifier::Stats runPass(picostation::DiscImage &image) {
+    static picostation::ImageVerifier verifier;
+    CHECK(image.load("./verify.cue") == FR_OK);
+    verifier.start("./verify.cue", &image);
+    for (int i = 0; i <= image.sectorCount() && verifier.isRunning(); i++) {
+        verifier.step();
+    }
+    CHECK(!verifier.isRunning());
+    return verifier.getStats();
+}
+
+int main() {
+    static constexpr int c_sectors = 600;
+    static constexpr int c_badSector = 345;
+    images::Bytes track = images::track(0, c_sectors, 0);
+    images::write("verify.bin", track);
+    images::write("verify.cue",
+                  std::string("FILE \"verify.bin\" BINARY\n  TRACK 01 MODE1/2352\n    INDEX 01 00:00:00\n"));
+    writeSidecar(track);
+    remove("verify.bad");
+
+    static picostation::DiscImage image;
+    picostation::ImageVerifier::Stats stats = runPass(image);
+    CHECK(stats.checked == c_sectors);
+    CHECK(stats.bad == 0);
+    CHECK(stats.unverified == 0);
+    CHECK(readBadList().empty());
+
+    images::Bytes damaged = track;
+    damaged[size_t(c_badSector) * 2352 + 1000] ^= 0x10;
+    images::write("verify.bin", damaged);
+    const std::string expected = "# 1 bad of " + std::to_string(c_sectors) + " checked\n" +
+                                 std::to_string(c_badSector) + "\n";
+
+    stats = runPass(image);  // Against the checksums
+    CHECK(stats.checked == c_sectors);
+    CHECK(stats.bad == 1);
+    CHECK(readBadList() == expected);
+
+    remove("verify.crc");
+    stats = runPass(image);  // Against the EDC
+    CHECK(stats.checked == c_sectors);
+    CHECK(stats.bad == 1);
+    CHECK(readBadList() == expected);
+
+    images::write("verify.bin", track);
+    stats = runPass(image);
+    CHECK(stats.bad == 0);
+    CHECK(readBadList().empty());  // The stale list goes once the image is good again
+    printf("verify: %u sectors checked, %u bad\n", (unsigned)stats.checked, (unsigned)stats.bad);
+    return g_checkFailures ? 1 : 0;
+}
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+# Writes the <cue name>.crc checksum file that ImageVerifier compares the image against on the console: a CRC-32
+# of every sector of each FILE as stored. Run it on a known good copy of the image.
+# Usage: tools/make_crc.py game.cue...
+
+import argparse
+import os
+import re
+import struct
+import sys
+import zlib
+
+# Bytes per stored sector for the cue track modes the firmware reads
+SECTOR_SIZES = {
+    "AUDIO": 2352,
+    "MODE1/2352": 2352,
+    "MODE2/2352": 2352,
+    "MODE1/2048": 2048,
+    "MODE2/2336": 2336,
+}
+MAX_FILES = 99
+HEADER = struct.Struct("<4sHH")
+FILE_ENTRY = struct.Struct("<IIHH")
+READ_SECTORS = 1024
+FILE_LINE = re.compile(r'\s*FILE\s+(?:"([^"]*)"|(\S+))', re.IGNORECASE)
+TRACK_LINE = re.compile(r"\s*TRACK\s+\d+\s+(\S+)", re.IGNORECASE)
+
+
+def parse_cue(path):
+    """Returns [(path, sector size or None)] in FILE order, the size taken from each file's first track."""
+    folder = os.path.dirname(path)
+    files = []
+    with open(path, encoding="latin-1") as cue:
+        for line in cue:
+            file_match = FILE_LINE.match(line)
+            track_match = TRACK_LINE.match(line)
+            if file_match:
+                files.append([os.path.join(folder, file_match.group(1) or file_match.group(2)), None])
+            elif track_match and files and files[-1][1] is None:
+                files[-1][1] = SECTOR_SIZES.get(track_match.group(1).upper(), 0)
+    return [(name, size) for name, size in files]
+
+
+def checksums(path, sector_size):
+    """CRC-32 per stored sector, empty when the firmware would decode the file rather than read it."""
+    if not sector_size or not os.path.isfile(path):
+        return []
+    with open(path, "rb") as image:
+        if image.read(4) in (b"RIFF", b"fLaC"):
+            return []
+        image.seek(0)
+        crcs = []
+        while True:
+            block = image.read(sector_size * READ_SECTORS)
+            view = memoryview(block)
+            for offset in range(0, len(block) - sector_size + 1, sector_size):
+                crcs.append(zlib.crc32(view[offset : offset + sector_size]))
+            if len(block) < sector_size * READ_SECTORS:
+                return crcs
+
+
+def write_sidecar(cue_path):
+    files = parse_cue(cue_path)
+    if not files or len(files) > MAX_FILES:
+        print(f"{cue_path}: {len(files)} files, skipped", file=sys.stderr)
+        return False
+
+    tables = [checksums(path, size) for path, size in files]
+    offset = HEADER.size + FILE_ENTRY.size * len(files)
+    entries = []
+    for (path, size), crcs in zip(files, tables):
+        entries.append(FILE_ENTRY.pack(offset, len(crcs), size if crcs else 0, 0))
+        offset += 4 * len(crcs)
+        if not crcs:
+            print(f"{cue_path}: no checksums for {os.path.basename(path)}", file=sys.stderr)
+
+    out_path = os.path.splitext(cue_path)[0] + ".crc"
+    with open(out_path, "wb") as out:
+        out.write(HEADER.pack(b"PSCK", 1, len(files)))
+        out.writelines(entries)
+        for crcs in tables:
+            out.write(struct.pack(f"<{len(crcs)}I", *crcs))
+    print(f"{out_path}: {sum(len(crcs) for crcs in tables)} sectors in {len(files)} files")
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("cue", nargs="+")
+    args = parser.parse_args()
+    ok = all([write_sidecar(path) for path in args.cue])
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+# Summarises where the firmware's statics landed: per-region usage and the largest symbols in each, then which
+# hot path functions run from flash through the XIP cache.
+# Usage: tools/ram_report.py build/picostation.elf [--nm arm-none-eabi-nm] [--top 10] [--code]
+
+import argparse
+import subprocess
+import sys
+
+# RP2040 address map, main SRAM is word-striped over banks 0-3
+REGIONS = [
+    ("flash", 0x10000000, 2 * 1024 * 1024),
+    ("sram (striped)", 0x20000000, 256 * 1024),
+    ("scratch_x (core1)", 0x20040000, 4 * 1024),
+    ("scratch_y (core0)", 0x20041000, 4 * 1024),
+]
+
+# Called for every sector, SubQ frame or mechacon command; all of these should be in RAM
+HOT_PATH = [
+    "picostation::I2S::start",
+    "picostation::I2S::psnee",
+    "picostation::SectorCache::get",
+    "picostation::SectorCache::prefetch",
+    "picostation::DiscImage::readData",
+    "picostation::DiscImage::syntheticSector",
+    "picostation::DiscImage::generateSubQ",
+    "picostation::SubQ::start_subq",
+    "picostation::core0Entry",
+    "picostation::mechcommand::interrupt_xlat",
+    "picostation::mechcommand::updateMechSens",
+    "f_read",
+    "f_lseek",
+    "disk_read",
+]
+CODE_TYPES = "tTwW"
+
+
+def region_of(address):
+    for name, start, size in REGIONS:
+        if start <= address < start + size:
+            return name
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("elf")
+    parser.add_argument("--nm", default="arm-none-eabi-nm")
+    parser.add_argument("--top", type=int, default=10)
+    parser.add_argument("--code", action="store_true", help="list every function and where it runs from")
+    args = parser.parse_args()
+
+    output = subprocess.run([args.nm, "-S", "-C", "--size-sort", args.elf], capture_output=True, text=True,
+                            check=True).stdout
+
+    symbols = {name: [] for name, _, _ in REGIONS}
+    functions = {}
+    for line in output.splitlines():
+        fields = line.split(maxsplit=3)
+        if len(fields) != 4:
+            continue
+        address, size, kind, name = int(fields[0], 16), int(fields[1], 16), fields[2], fields[3]
+        region = region_of(address)
+        if region is None:
+            continue
+        if kind in CODE_TYPES:
+            functions[name.split("(")[0]] = region
+        # Initialised RAM data also has its load image in flash, only the RAM copy is counted
+        symbols[region].append((size, kind, name))
+
+    for name, start, size in REGIONS:
+        entries = sorted(symbols[name], reverse=True)
+        used = sum(entry[0] for entry in entries)
+        print(f"{name:20} {used:8} / {size:8} bytes ({100.0 * used / size:5.1f}%)")
+        for entry_size, kind, symbol in entries[:args.top]:
+            print(f"    {entry_size:8} {kind} {symbol}")
+
+    print()
+    in_flash = [name for name in HOT_PATH if functions.get(name) == "flash"]
+    missing = [name for name in HOT_PATH if name not in functions]
+    print("hot path in flash: " + (", ".join(in_flash) if in_flash else "none"))
+    if missing:
+        print("hot path not found (inlined or renamed): " + ", ".join(missing))
+
+    if args.code:
+        print()
+        for name, region in sorted(functions.items(), key=lambda item: (item[1], item[0])):
+            print(f"{region:20} {name}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())